@@ -0,0 +1,220 @@
+/*
+ * BenchmarkSupport.hpp
+ *
+ * Helpers shared by the benchmarks: key distributions, latency samples and histograms with percentiles and a
+ * multi-threaded runner.
+ */
+
+#ifndef BENCHMARKSUPPORT_HPP_
+#define BENCHMARKSUPPORT_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+    // random number generator used by all benchmark threads, seeded per thread
+    typedef std::mt19937_64 Random;
+
+    // Zipfian distribution over [0, n) as used by YCSB (Gray et al., "Quickly generating billion-record synthetic
+    // databases"), rank 0 is the most popular item. Construction is O(n), next() is O(1)
+    class ZipfianGenerator {
+    public:
+        static constexpr double YCSB_THETA = 0.99;
+
+        explicit ZipfianGenerator(const uint64_t n, const double theta = YCSB_THETA) :
+                mN(n), mTheta(theta), mAlpha(1.0 / (1.0 - theta)), mZetaN(zeta(n, theta)), mEta(
+                        (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta(2, theta) / mZetaN)), mUniform(0.0,
+                        1.0) {
+        }
+
+        uint64_t next(Random &random) {
+            const double u = mUniform(random);
+            const double uz = u * mZetaN;
+            if (uz < 1.0) {
+                return 0;
+            }
+            if (uz < 1.0 + std::pow(0.5, mTheta)) {
+                return 1;
+            }
+            return std::min<uint64_t>(mN - 1, static_cast<uint64_t>(mN * std::pow(mEta * u - mEta + 1.0, mAlpha)));
+        }
+
+    private:
+        static double zeta(const uint64_t n, const double theta) {
+            double sum = 0;
+            for (uint64_t i = 1; i <= n; i++) {
+                sum += 1.0 / std::pow(static_cast<double>(i), theta);
+            }
+            return sum;
+        }
+
+        const uint64_t mN;
+        const double mTheta;
+        const double mAlpha;
+        const double mZetaN;
+        const double mEta;
+        std::uniform_real_distribution<double> mUniform;
+    };
+
+    // spreads the ranks of a skewed distribution over the key space, so the popular keys do not share rows (FNV-1a)
+    inline uint64_t scramble(const uint64_t rank, const uint64_t keyCount) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (int i = 0; i < 8; i++) {
+            hash = (hash ^ ((rank >> (8 * i)) & 0xff)) * 1099511628211ULL;
+        }
+        return hash % keyCount;
+    }
+
+    // latencies of one kind of operation in nanoseconds
+    class LatencySamples {
+    public:
+        void add(const uint64_t nanoseconds) {
+            mSamples.push_back(nanoseconds);
+        }
+
+        void addAll(const LatencySamples &other) {
+            mSamples.insert(mSamples.end(), other.mSamples.begin(), other.mSamples.end());
+        }
+
+        size_t count() const {
+            return mSamples.size();
+        }
+
+        // latency below which the given fraction of the samples lies, reorders the samples
+        uint64_t percentile(const double quantile) {
+            if (mSamples.empty()) {
+                return 0;
+            }
+            const size_t rank = std::min(mSamples.size() - 1, static_cast<size_t>(quantile * mSamples.size()));
+            std::nth_element(mSamples.begin(), mSamples.begin() + rank, mSamples.end());
+            return mSamples[rank];
+        }
+
+    private:
+        std::vector<uint64_t> mSamples;
+    };
+
+    // histogram of latencies in nanoseconds with the bucket layout of HdrHistogram: values below 128 have their own
+    // bucket, above that every power of two is split into 64 linear sub-buckets, so every value is recorded with a
+    // relative error below 1/64 and recording is O(1) without any allocation
+    class HdrHistogram {
+    public:
+        HdrHistogram() :
+                mCounts(LINEAR_LIMIT + 57 * SUB_BUCKET_COUNT, 0), mTotal(0), mMax(0) {
+        }
+
+        void record(const uint64_t value) {
+            mCounts[indexOf(value)]++;
+            mTotal++;
+            mMax = std::max(mMax, value);
+        }
+
+        void add(const HdrHistogram &other) {
+            for (size_t i = 0; i < mCounts.size(); i++) {
+                mCounts[i] += other.mCounts[i];
+            }
+            mTotal += other.mTotal;
+            mMax = std::max(mMax, other.mMax);
+        }
+
+        uint64_t count() const {
+            return mTotal;
+        }
+
+        uint64_t max() const {
+            return mMax;
+        }
+
+        // highest value equivalent to the value at the given quantile in [0, 1], 0 if the histogram is empty
+        uint64_t percentile(const double quantile) const {
+            const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * mTotal)));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < mCounts.size(); i++) {
+                seen += mCounts[i];
+                if (seen >= rank) {
+                    return std::min(mMax, highestEquivalentValue(i));
+                }
+            }
+            return mMax;
+        }
+
+    private:
+        static const uint64_t LINEAR_LIMIT = 128;
+        static const uint64_t SUB_BUCKET_COUNT = 64;
+
+        static size_t indexOf(const uint64_t value) {
+            if (value < LINEAR_LIMIT) {
+                return value;
+            }
+            // keep the 7 most significant bits, the highest of them is always set
+            const int shift = 63 - __builtin_clzll(value) - 6;
+            return LINEAR_LIMIT + (shift - 1) * SUB_BUCKET_COUNT + ((value >> shift) - SUB_BUCKET_COUNT);
+        }
+
+        static uint64_t highestEquivalentValue(const size_t index) {
+            if (index < LINEAR_LIMIT) {
+                return index;
+            }
+            const int shift = (index - LINEAR_LIMIT) / SUB_BUCKET_COUNT + 1;
+            const uint64_t top = (index - LINEAR_LIMIT) % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+            return ((top + 1) << shift) - 1;
+        }
+
+        std::vector<uint64_t> mCounts;
+        uint64_t mTotal;
+        uint64_t mMax;
+    };
+
+    // runs fn() and returns its duration in nanoseconds
+    template<typename Fn>
+    uint64_t timed(Fn fn) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // runs fn(threadIndex) on threadCount threads which start at the same time, returns the wall clock time in seconds
+    template<typename Fn>
+    double runThreads(const int threadCount, Fn fn) {
+        std::vector<std::thread> threads;
+        std::chrono::steady_clock::time_point start;
+        {
+            // hold the threads back until all of them have been created
+            std::atomic<bool> go(false);
+            for (int t = 0; t < threadCount; t++) {
+                threads.push_back(std::thread([&, t]() {
+                    while (!go.load(std::memory_order_acquire)) {
+                        std::this_thread::yield();
+                    }
+                    fn(t);
+                }));
+            }
+            start = std::chrono::steady_clock::now();
+            go.store(true, std::memory_order_release);
+            for (auto &thread : threads) {
+                thread.join();
+            }
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    // 1, 2, 4, ... up to and always including maxThreads
+    inline std::vector<int> threadCounts(const int maxThreads) {
+        std::vector<int> counts;
+        for (int threads = 1; threads < maxThreads; threads *= 2) {
+            counts.push_back(threads);
+        }
+        counts.push_back(std::max(1, maxThreads));
+        return counts;
+    }
+}
+
+#endif /* BENCHMARKSUPPORT_HPP_ */
@@ -0,0 +1,312 @@
+/*
+ * ComparisonBenchmark.cpp
+ *
+ * Runs identical workloads against HashMap and other thread-safe maps and reports throughput and tail latency per thread
+ * count as CSV (default) or JSON:
+ *
+ *   HashMap                 per-row reader-writer locks
+ *   FlatIntegerHashMap      open addressing without nodes, slots claimed by compare-and-swap
+ *   locked_unordered_map    std::unordered_map guarded by a single std::shared_timed_mutex (the project is built as
+ *                           C++14, which lacks std::shared_mutex)
+ *   sharded_unordered_map   SHARD_COUNT std::unordered_maps, each guarded by its own std::shared_timed_mutex
+ *   tbb_concurrent_hash_map tbb::concurrent_hash_map, only if built with -DHAVE_TBB
+ *
+ * Every map is preloaded with recordCount keys, the workloads mix get() and put() of existing keys ("read_heavy" 95/5,
+ * "update_heavy" 50/50) and are run with uniform and Zipfian keys.
+ *
+ * Build: g++ -std=c++14 -O2 -I include -I bench bench/ComparisonBenchmark.cpp -o ComparisonBenchmark -lpthread
+ *        (add -DHAVE_TBB ... -ltbb to include TBB)
+ * Usage: ComparisonBenchmark [recordCount] [operationsPerThread] [maxThreads] [csv|json]
+ */
+
+#include <BenchmarkSupport.hpp>
+#include <FlatIntegerHashMap.hpp>
+#include <HashMap.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifdef HAVE_TBB
+#include <tbb/concurrent_hash_map.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+    const int SHARD_COUNT = 64;
+
+    class HashMapAdapter {
+    public:
+        static const char *name() {
+            return "HashMap";
+        }
+
+        explicit HashMapAdapter(const long recordCount) :
+                mMap(recordCount) {
+        }
+
+        bool get(const long key, long &value) {
+            return mMap.get(key, value);
+        }
+
+        void put(const long key, const long value) {
+            mMap.put(key, value);
+        }
+
+    private:
+        HashMap<long, long> mMap;
+    };
+
+    class FlatIntegerHashMapAdapter {
+    public:
+        static const char *name() {
+            return "FlatIntegerHashMap";
+        }
+
+        explicit FlatIntegerHashMapAdapter(const long recordCount) :
+                mMap(recordCount) {
+        }
+
+        bool get(const long key, long &value) {
+            return mMap.get(key, value);
+        }
+
+        void put(const long key, const long value) {
+            mMap.put(key, value);
+        }
+
+    private:
+        FlatIntegerHashMap<long, long> mMap;
+    };
+
+    class LockedUnorderedMap {
+    public:
+        static const char *name() {
+            return "locked_unordered_map";
+        }
+
+        explicit LockedUnorderedMap(const long recordCount) {
+            mMap.reserve(recordCount);
+        }
+
+        bool get(const long key, long &value) {
+            shared_lock<shared_timed_mutex> lock(mMutex);
+            const auto it = mMap.find(key);
+            if (it == mMap.end()) {
+                return false;
+            }
+            value = it->second;
+            return true;
+        }
+
+        void put(const long key, const long value) {
+            lock_guard<shared_timed_mutex> lock(mMutex);
+            mMap[key] = value;
+        }
+
+    private:
+        unordered_map<long, long> mMap;
+        shared_timed_mutex mMutex;
+    };
+
+    class ShardedUnorderedMap {
+    public:
+        static const char *name() {
+            return "sharded_unordered_map";
+        }
+
+        explicit ShardedUnorderedMap(const long recordCount) {
+            for (auto &shard : mShards) {
+                shard.map.reserve(recordCount / SHARD_COUNT + 1);
+            }
+        }
+
+        bool get(const long key, long &value) {
+            Shard &shard = shardOf(key);
+            shared_lock<shared_timed_mutex> lock(shard.mutex);
+            const auto it = shard.map.find(key);
+            if (it == shard.map.end()) {
+                return false;
+            }
+            value = it->second;
+            return true;
+        }
+
+        void put(const long key, const long value) {
+            Shard &shard = shardOf(key);
+            lock_guard<shared_timed_mutex> lock(shard.mutex);
+            shard.map[key] = value;
+        }
+
+    private:
+        // aligned to separate the locks of neighbouring shards
+        struct alignas(64) Shard {
+            unordered_map<long, long> map;
+            shared_timed_mutex mutex;
+        };
+
+        Shard &shardOf(const long key) {
+            return mShards[hash<long>()(key) % SHARD_COUNT];
+        }
+
+        Shard mShards[SHARD_COUNT];
+    };
+
+#ifdef HAVE_TBB
+    class TbbConcurrentHashMap {
+    public:
+        static const char *name() {
+            return "tbb_concurrent_hash_map";
+        }
+
+        explicit TbbConcurrentHashMap(const long recordCount) :
+                mMap(recordCount) {
+        }
+
+        bool get(const long key, long &value) {
+            tbb::concurrent_hash_map<long, long>::const_accessor accessor;
+            if (!mMap.find(accessor, key)) {
+                return false;
+            }
+            value = accessor->second;
+            return true;
+        }
+
+        void put(const long key, const long value) {
+            tbb::concurrent_hash_map<long, long>::accessor accessor;
+            mMap.insert(accessor, key);
+            accessor->second = value;
+        }
+
+    private:
+        tbb::concurrent_hash_map<long, long> mMap;
+    };
+#endif
+
+    struct Workload {
+        const char *name;
+        int readPercent;
+    };
+
+    const Workload WORKLOADS[] = { { "read_heavy", 95 }, { "update_heavy", 50 } };
+
+    struct Result {
+        string map;
+        string workload;
+        string distribution;
+        int threads;
+        double opsPerSecond;
+        uint64_t p50;
+        uint64_t p99;
+        uint64_t p999;
+    };
+
+    template<typename Map>
+    Result run(const Workload &workload, const bool zipfianKeys, const int threadCount, const long recordCount,
+            const long operationsPerThread, const bench::ZipfianGenerator &zipfian) {
+        Map map(recordCount);
+        for (long key = 0; key < recordCount; key++) {
+            map.put(key, key);
+        }
+
+        vector<bench::LatencySamples> samples(threadCount);
+        const double seconds = bench::runThreads(threadCount, [&](const int t) {
+            bench::Random random(t + 1);
+            bench::ZipfianGenerator keyRanks(zipfian);
+            uniform_int_distribution<long> uniformKeys(0, recordCount - 1);
+            uniform_int_distribution<int> percent(0, 99);
+
+            long value;
+            for (long i = 0; i < operationsPerThread; i++) {
+                const long key = zipfianKeys ? bench::scramble(keyRanks.next(random), recordCount) : uniformKeys(random);
+                const bool read = percent(random) < workload.readPercent;
+                samples[t].add(bench::timed([&]() {
+                    if (read) {
+                        map.get(key, value);
+                    } else {
+                        map.put(key, i);
+                    }
+                }));
+            }
+        });
+
+        bench::LatencySamples merged;
+        for (const auto &threadSamples : samples) {
+            merged.addAll(threadSamples);
+        }
+        Result result;
+        result.map = Map::name();
+        result.workload = workload.name;
+        result.distribution = zipfianKeys ? "zipfian" : "uniform";
+        result.threads = threadCount;
+        result.opsPerSecond = threadCount * operationsPerThread / seconds;
+        result.p50 = merged.percentile(0.5);
+        result.p99 = merged.percentile(0.99);
+        result.p999 = merged.percentile(0.999);
+        return result;
+    }
+
+    template<typename Map>
+    void runAll(vector<Result> &results, const long recordCount, const long operationsPerThread, const int maxThreads,
+            const bench::ZipfianGenerator &zipfian) {
+        for (const auto &workload : WORKLOADS) {
+            for (const bool zipfianKeys : { false, true }) {
+                for (const int threads : bench::threadCounts(maxThreads)) {
+                    results.push_back(
+                            run<Map>(workload, zipfianKeys, threads, recordCount, operationsPerThread, zipfian));
+                }
+            }
+        }
+    }
+
+    void printCsv(const vector<Result> &results) {
+        cout << "map,workload,distribution,threads,ops_per_sec,p50_ns,p99_ns,p999_ns" << endl;
+        for (const auto &result : results) {
+            cout << result.map << "," << result.workload << "," << result.distribution << "," << result.threads << ","
+                    << static_cast<long>(result.opsPerSecond) << "," << result.p50 << "," << result.p99 << ","
+                    << result.p999 << endl;
+        }
+    }
+
+    void printJson(const vector<Result> &results) {
+        cout << "[" << endl;
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto &result = results[i];
+            cout << "  {\"map\": \"" << result.map << "\", \"workload\": \"" << result.workload
+                    << "\", \"distribution\": \"" << result.distribution << "\", \"threads\": " << result.threads
+                    << ", \"ops_per_sec\": " << static_cast<long>(result.opsPerSecond) << ", \"p50_ns\": "
+                    << result.p50 << ", \"p99_ns\": " << result.p99 << ", \"p999_ns\": " << result.p999 << "}"
+                    << (i + 1 < results.size() ? "," : "") << endl;
+        }
+        cout << "]" << endl;
+    }
+}
+
+int main(int argc, const char * argv[]) {
+    const long recordCount = argc > 1 ? atol(argv[1]) : 100000;
+    const long operationsPerThread = argc > 2 ? atol(argv[2]) : 100000;
+    const int maxThreads = argc > 3 ? atoi(argv[3]) : max(1u, thread::hardware_concurrency());
+    const string format = argc > 4 ? argv[4] : "csv";
+
+    const bench::ZipfianGenerator zipfian(recordCount);
+    vector<Result> results;
+    runAll<HashMapAdapter>(results, recordCount, operationsPerThread, maxThreads, zipfian);
+    runAll<FlatIntegerHashMapAdapter>(results, recordCount, operationsPerThread, maxThreads, zipfian);
+    runAll<LockedUnorderedMap>(results, recordCount, operationsPerThread, maxThreads, zipfian);
+    runAll<ShardedUnorderedMap>(results, recordCount, operationsPerThread, maxThreads, zipfian);
+#ifdef HAVE_TBB
+    runAll<TbbConcurrentHashMap>(results, recordCount, operationsPerThread, maxThreads, zipfian);
+#endif
+
+    if (format == "json") {
+        printJson(results);
+    } else {
+        printCsv(results);
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * CountingBenchmark.cpp
+ *
+ * Counts events with Zipfian distributed keys, so a few hot keys receive most of the updates, and reports the
+ * throughput of:
+ *
+ *   increment   CounterHashMap::increment(), a fetch_add under the shared row lock
+ *   combiner    CounterHashMap::Combiner per thread with the given buffer size, flushing merged deltas in batches
+ *
+ * At the end all counters are summed up to verify that no update has been lost.
+ *
+ * Build: g++ -std=c++14 -O2 -I include -I bench bench/CountingBenchmark.cpp -o CountingBenchmark -lpthread
+ * Usage: CountingBenchmark [keyCount] [incrementsPerThread] [maxThreads] [combinerKeys]
+ */
+
+#include <BenchmarkSupport.hpp>
+#include <CounterHashMap.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    void run(const bool combining, const int threadCount, const long keyCount, const long incrementsPerThread,
+            const size_t combinerKeys, const bench::ZipfianGenerator &zipfian) {
+        CounterHashMap<long> map(keyCount);
+
+        // the keys are drawn beforehand, so only the counting is measured
+        vector<vector<long> > keys(threadCount);
+        for (int t = 0; t < threadCount; t++) {
+            bench::Random random(t + 1);
+            bench::ZipfianGenerator keyRanks(zipfian);
+            keys[t].reserve(incrementsPerThread);
+            for (long i = 0; i < incrementsPerThread; i++) {
+                keys[t].push_back(bench::scramble(keyRanks.next(random), keyCount));
+            }
+        }
+
+        const double seconds = bench::runThreads(threadCount, [&](const int t) {
+            if (combining) {
+                CounterHashMap<long>::Combiner combiner(map, combinerKeys);
+                for (const long key : keys[t]) {
+                    combiner.increment(key);
+                }
+            } else {
+                for (const long key : keys[t]) {
+                    map.increment(key);
+                }
+            }
+        });
+
+        int64_t total = 0;
+        map.for_each([&](const long, const int64_t count) {
+            total += count;
+        });
+        cout << (combining ? "combiner" : "increment") << "," << threadCount << ","
+                << static_cast<long>(threadCount * incrementsPerThread / seconds) << ","
+                << (total == threadCount * incrementsPerThread ? "ok" : "lost updates") << endl;
+    }
+}
+
+int main(int argc, const char * argv[]) {
+    const long keyCount = argc > 1 ? atol(argv[1]) : 10000;
+    const long incrementsPerThread = argc > 2 ? atol(argv[2]) : 1000000;
+    const int maxThreads = argc > 3 ? atoi(argv[3]) : max(1u, thread::hardware_concurrency());
+    const size_t combinerKeys = argc > 4 ? atol(argv[4]) : 64;
+
+    const bench::ZipfianGenerator zipfian(keyCount);
+
+    cout << "mode,threads,increments_per_sec,check" << endl;
+    for (const int threads : bench::threadCounts(maxThreads)) {
+        run(false, threads, keyCount, incrementsPerThread, combinerKeys, zipfian);
+        run(true, threads, keyCount, incrementsPerThread, combinerKeys, zipfian);
+    }
+    return 0;
+}
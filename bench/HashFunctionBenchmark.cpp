@@ -0,0 +1,113 @@
+/*
+ * HashFunctionBenchmark.cpp
+ *
+ * Compares the hash functions of HashFunctions.hpp with std::hash and StringHash:
+ *
+ *   string     hashes per second and bytes per second for keys of 8 to 4096 bytes
+ *   integer    hashes per second of long keys
+ *   strided    get() throughput of a HashMap<long, long> holding multiples of its row count, and the longest chain.
+ *              With the identity std::hash all keys fall into row 0, IntegerHash spreads them over all rows
+ *
+ * Build: g++ -std=c++14 -O2 -I include -I bench bench/HashFunctionBenchmark.cpp -o HashFunctionBenchmark -lpthread
+ * Usage: HashFunctionBenchmark [hashesPerRun] [stridedKeys]
+ */
+
+#include <BenchmarkSupport.hpp>
+#include <HashFunctions.hpp>
+#include <HashMap.hpp>
+#include <StringHash.hpp>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    const size_t STRING_LENGTHS[] = { 8, 16, 32, 64, 256, 1024, 4096 };
+
+    // distinct keys hashed in turn, so the results do not depend on a single cached key
+    const int KEY_COUNT = 64;
+
+    // keeps the compiler from dropping the hashing
+    volatile size_t sink;
+
+    template<typename Hash>
+    void runString(const char *name, const size_t length, const long hashes) {
+        vector<string> keys;
+        bench::Random random(length);
+        for (int i = 0; i < KEY_COUNT; i++) {
+            string key(length, ' ');
+            for (auto &c : key) {
+                c = static_cast<char>('a' + random() % 26);
+            }
+            keys.push_back(key);
+        }
+
+        const Hash hash;
+        size_t result = 0;
+        const uint64_t nanoseconds = bench::timed([&]() {
+            for (long i = 0; i < hashes; i++) {
+                result ^= hash(keys[i % KEY_COUNT]);
+            }
+        });
+        sink = result;
+        cout << "string," << name << "," << length << "," << static_cast<long>(hashes * 1e9 / nanoseconds) << ","
+                << hashes * length / static_cast<double>(nanoseconds) << endl;
+    }
+
+    template<typename Hash>
+    void runInteger(const char *name, const long hashes) {
+        const Hash hash;
+        size_t result = 0;
+        const uint64_t nanoseconds = bench::timed([&]() {
+            for (long i = 0; i < hashes; i++) {
+                result ^= hash(i);
+            }
+        });
+        sink = result;
+        cout << "integer," << name << ",8," << static_cast<long>(hashes * 1e9 / nanoseconds) << ","
+                << hashes * 8 / static_cast<double>(nanoseconds) << endl;
+    }
+
+    template<typename Hash>
+    void runStrided(const char *name, const long keyCount) {
+        const int rowCount = static_cast<int>(keyCount);
+        HashMap<long, long, Hash> map(rowCount);
+        for (long i = 0; i < keyCount; i++) {
+            map.put(i * rowCount, i);
+        }
+
+        long value;
+        const long lookups = 10 * keyCount;
+        const uint64_t nanoseconds = bench::timed([&]() {
+            for (long i = 0; i < lookups; i++) {
+                map.get(i % keyCount * rowCount, value);
+            }
+        });
+        cout << "strided," << name << "," << keyCount << "," << static_cast<long>(lookups * 1e9 / nanoseconds) << ","
+                << map.stats().chainLengths.size() - 1 << endl;
+    }
+}
+
+int main(int argc, const char * argv[]) {
+    const long hashes = argc > 1 ? atol(argv[1]) : 10000000;
+    const long stridedKeys = argc > 2 ? atol(argv[2]) : 2000;
+
+    // bytes_per_ns is GB/s, longest_chain is reported for strided instead
+    cout << "test,hash,key_bytes,hashes_per_sec,bytes_per_ns_or_longest_chain" << endl;
+    for (const size_t length : STRING_LENGTHS) {
+        const long scaled = max(1L, static_cast<long>(hashes * 8 / length));
+        runString<hash<string> >("std::hash", length, scaled);
+        runString<StringHash>("StringHash", length, scaled);
+        runString<FastStringHash>("FastStringHash", length, scaled);
+    }
+    runInteger<hash<long> >("std::hash", hashes);
+    runInteger<IntegerHash>("IntegerHash", hashes);
+
+    runStrided<hash<long> >("std::hash", stridedKeys);
+    runStrided<IntegerHash>("IntegerHash", stridedKeys);
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * LoadingCacheBenchmark.cpp
+ *
+ * Compares the number of backend loads and the run time of a read-through cache built from get() and put() with
+ * get_or_load(), which coalesces concurrent misses of the same key. The backend is a fake loader sleeping for a fixed
+ * latency.
+ *
+ * Build: g++ -std=c++14 -O2 -I include bench/LoadingCacheBenchmark.cpp -o LoadingCacheBenchmark -lpthread
+ * Usage: LoadingCacheBenchmark [threads] [keys] [lookupsPerThread] [loadLatencyMicroseconds]
+ */
+
+#include <HashMap.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    // runs lookup(map, key, value) for lookupsPerThread keys on every thread, all threads walk the keys in the same
+    // order so that they miss the same keys at the same time. Returns the wall clock time in milliseconds
+    template<typename Lookup>
+    double run(const int threadCount, const int keyCount, const int lookupsPerThread, Lookup lookup) {
+        HashMap<int, long> map;
+        const auto start = chrono::steady_clock::now();
+        vector<thread> threads;
+        for (int t = 0; t < threadCount; t++) {
+            threads.push_back(thread([&]() {
+                long value;
+                for (int i = 0; i < lookupsPerThread; i++) {
+                    lookup(map, i % keyCount, value);
+                }
+            }));
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+}
+
+int main(int argc, const char * argv[]) {
+    const int threadCount = argc > 1 ? atoi(argv[1]) : 32;
+    const int keyCount = argc > 2 ? atoi(argv[2]) : 100;
+    const int lookupsPerThread = argc > 3 ? atoi(argv[3]) : 1000;
+    const chrono::microseconds latency(argc > 4 ? atoi(argv[4]) : 1000);
+
+    atomic<long> loadCount(0);
+    auto loader = [&](const int &key, long &value) {
+        loadCount++;
+        this_thread::sleep_for(latency);
+        value = key;
+        return true;
+    };
+
+    cout << "variant,loads,time_ms" << endl;
+
+    const double naiveTime = run(threadCount, keyCount, lookupsPerThread, [&](HashMap<int, long> &map, const int key,
+            long &value) {
+        if (!map.get(key, value) && loader(key, value)) {
+            map.put(key, value);
+        }
+    });
+    cout << "get_put," << loadCount << "," << naiveTime << endl;
+
+    loadCount = 0;
+    const double singleFlightTime = run(threadCount, keyCount, lookupsPerThread, [&](HashMap<int, long> &map,
+            const int key, long &value) {
+        map.get_or_load(key, value, loader);
+    });
+    cout << "get_or_load," << loadCount << "," << singleFlightTime << endl;
+    return 0;
+}
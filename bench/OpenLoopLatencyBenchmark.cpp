@@ -0,0 +1,152 @@
+/*
+ * OpenLoopLatencyBenchmark.cpp
+ *
+ * Open-loop load generator for HashMap: worker threads issue get() (90%) and put() (10%) at a fixed total target rate,
+ * independent of how fast the map responds. Every operation has an intended start time on the schedule, a worker that
+ * falls behind (e.g. while resize() holds the map lock exclusively) issues the overdue operations back to back.
+ * Latencies are recorded into HDR histograms twice:
+ *
+ *   corrected    completion time - intended start time, includes the time an operation waited behind a stall. This
+ *                corrects the coordinated omission of closed-loop benchmarks, which stop issuing requests while the
+ *                system stalls and thus hide the stall from all requests that would have been sent meanwhile
+ *   service      completion time - actual start time, what a closed-loop benchmark would report
+ *
+ * The load runs in three phases: without disruption, while another thread calls resize() every eventInterval
+ * milliseconds (alternating between two row counts) and while another thread calls clear() at the same interval.
+ *
+ * Build: g++ -std=c++14 -O2 -I include -I bench bench/OpenLoopLatencyBenchmark.cpp -o OpenLoopLatencyBenchmark -lpthread
+ * Usage: OpenLoopLatencyBenchmark [targetOpsPerSecond] [threads] [phaseSeconds] [recordCount] [eventIntervalMs]
+ */
+
+#include <BenchmarkSupport.hpp>
+#include <HashMap.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    enum Disruption {
+        NONE, RESIZE, CLEAR
+    };
+
+    const char * const DISRUPTION_NAMES[] = { "steady", "resize", "clear" };
+
+    const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999, 0.9999 };
+
+    struct Options {
+        double targetRate;
+        int threads;
+        double phaseSeconds;
+        long recordCount;
+        chrono::milliseconds eventInterval;
+    };
+
+    void printHistogram(const string &phase, const string &kind, const long events, const double achievedRate,
+            const bench::HdrHistogram &histogram) {
+        cout << phase << "," << kind << "," << events << "," << static_cast<long>(achievedRate) << ","
+                << histogram.count();
+        for (const double quantile : QUANTILES) {
+            cout << "," << histogram.percentile(quantile);
+        }
+        cout << "," << histogram.max() << endl;
+    }
+
+    void runPhase(const Disruption disruption, const Options &options) {
+        HashMap<long, long> map(options.recordCount);
+        for (long key = 0; key < options.recordCount; key++) {
+            map.put(key, key);
+        }
+
+        // every worker issues its share of the target rate
+        const chrono::nanoseconds interval(static_cast<long>(options.threads * 1e9 / options.targetRate));
+        const long operationsPerThread = static_cast<long>(options.phaseSeconds * options.targetRate / options.threads);
+        vector<bench::HdrHistogram> corrected(options.threads);
+        vector<bench::HdrHistogram> service(options.threads);
+
+        atomic<bool> running(true);
+        long events = 0;
+        thread disruptor([&]() {
+            bool grow = true;
+            while (running.load()) {
+                this_thread::sleep_for(options.eventInterval);
+                if (!running.load()) {
+                    break;
+                }
+                if (disruption == RESIZE) {
+                    map.resize(grow ? 2 * options.recordCount : options.recordCount);
+                    grow = !grow;
+                    events++;
+                } else if (disruption == CLEAR) {
+                    map.clear();
+                    events++;
+                }
+            }
+        });
+
+        const double seconds = bench::runThreads(options.threads, [&](const int t) {
+            bench::Random random(t + 1);
+            uniform_int_distribution<long> keys(0, options.recordCount - 1);
+            uniform_int_distribution<int> percent(0, 99);
+
+            // the workers' schedules are staggered evenly within one interval
+            const auto start = chrono::steady_clock::now() + interval * t / options.threads;
+            long value;
+            for (long i = 0; i < operationsPerThread; i++) {
+                const auto intended = start + interval * i;
+                auto now = chrono::steady_clock::now();
+                if (now < intended - chrono::microseconds(100)) {
+                    this_thread::sleep_until(intended - chrono::microseconds(50));
+                }
+                while ((now = chrono::steady_clock::now()) < intended) {
+                    this_thread::yield();
+                }
+
+                const long key = keys(random);
+                if (percent(random) < 90) {
+                    map.get(key, value);
+                } else {
+                    map.put(key, i);
+                }
+
+                const auto end = chrono::steady_clock::now();
+                corrected[t].record(chrono::duration_cast<chrono::nanoseconds>(end - intended).count());
+                service[t].record(chrono::duration_cast<chrono::nanoseconds>(end - now).count());
+            }
+        });
+
+        running.store(false);
+        disruptor.join();
+
+        bench::HdrHistogram correctedTotal;
+        bench::HdrHistogram serviceTotal;
+        for (int t = 0; t < options.threads; t++) {
+            correctedTotal.add(corrected[t]);
+            serviceTotal.add(service[t]);
+        }
+        const double achievedRate = options.threads * operationsPerThread / seconds;
+        printHistogram(DISRUPTION_NAMES[disruption], "corrected", events, achievedRate, correctedTotal);
+        printHistogram(DISRUPTION_NAMES[disruption], "service", events, achievedRate, serviceTotal);
+    }
+}
+
+int main(int argc, const char * argv[]) {
+    Options options;
+    options.targetRate = argc > 1 ? atof(argv[1]) : 200000;
+    options.threads = argc > 2 ? atoi(argv[2]) : 2;
+    options.phaseSeconds = argc > 3 ? atof(argv[3]) : 5;
+    options.recordCount = argc > 4 ? atol(argv[4]) : 1000000;
+    options.eventInterval = chrono::milliseconds(argc > 5 ? atoi(argv[5]) : 500);
+
+    cout << "phase,latency,events,achieved_ops_per_sec,count,p50_ns,p90_ns,p99_ns,p999_ns,p9999_ns,max_ns" << endl;
+    for (const auto disruption : { NONE, RESIZE, CLEAR }) {
+        runPhase(disruption, options);
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * ParallelScanBenchmark.cpp
+ *
+ * Measures the scaling of parallel_for_each() and parallel_reduce() with the number of worker threads. The
+ * parallel_for_each() callback only increments a thread-local counter, so the timing reflects the chunked row walk
+ * instead of contention on a counter shared by the workers.
+ *
+ * Build: g++ -std=c++14 -O2 -I include bench/ParallelScanBenchmark.cpp -o ParallelScanBenchmark -lpthread
+ * Usage: ParallelScanBenchmark [numberOfEntries] [maxThreads]
+ */
+
+#include <HashMap.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    const int DEFAULT_NUMBER_OF_ENTRIES = 10000000;
+
+    const int REPETITIONS = 5;
+
+    // entries visited by the calling thread, every worker counts in its own thread-local storage
+    thread_local long visitedEntries = 0;
+
+    // runs fn REPETITIONS times and returns the best wall clock time in milliseconds
+    template<typename Fn>
+    double bestOf(Fn fn) {
+        double best = 0;
+        for (int i = 0; i < REPETITIONS; i++) {
+            const auto start = chrono::steady_clock::now();
+            fn();
+            const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+            if (i == 0 || elapsed.count() < best) {
+                best = elapsed.count();
+            }
+        }
+        return best;
+    }
+}
+
+int main(int argc, const char * argv[]) {
+    const int numberOfEntries = argc > 1 ? atoi(argv[1]) : DEFAULT_NUMBER_OF_ENTRIES;
+    const int maxThreads = argc > 2 ? atoi(argv[2]) : max(1u, thread::hardware_concurrency());
+
+    vector<pair<long, long> > entries;
+    entries.reserve(numberOfEntries);
+    for (long i = 0; i < numberOfEntries; i++) {
+        entries.push_back(make_pair(i, i));
+    }
+    HashMap<long, long> map(entries.begin(), entries.end(), maxThreads);
+    entries.clear();
+
+    cout << "entries=" << map.size() << endl;
+    cout << "threads,for_each_ms,reduce_ms,for_each_speedup,reduce_speedup" << endl;
+
+    double forEachBaseline = 0;
+    double reduceBaseline = 0;
+    // doubles the thread count up to maxThreads, maxThreads itself is always measured
+    for (int threads = 1;; threads = min(2 * threads, maxThreads)) {
+        const double forEachTime = bestOf([&]() {
+            map.parallel_for_each([](const long &, const long &) {
+                visitedEntries++;
+            }, threads);
+        });
+
+        long sum = 0;
+        const double reduceTime = bestOf([&]() {
+            sum = map.parallel_reduce([](const long &, const long &value) {
+                return value;
+            }, [](const long a, const long b) {
+                return a + b;
+            }, 0L, threads);
+        });
+
+        if (threads == 1) {
+            forEachBaseline = forEachTime;
+            reduceBaseline = reduceTime;
+        }
+        cout << threads << "," << forEachTime << "," << reduceTime << "," << forEachBaseline / forEachTime << ","
+                << reduceBaseline / reduceTime << endl;
+
+        if (threads >= maxThreads) {
+            break;
+        }
+    }
+    return 0;
+}
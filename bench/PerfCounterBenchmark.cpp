@@ -0,0 +1,133 @@
+/*
+ * PerfCounterBenchmark.cpp
+ *
+ * Reports hardware performance counters per HashMap operation (instructions, cycles, L1 data and last level cache read
+ * misses, branch misses, see PerfCounters.hpp) for scenarios isolating the main costs of a lookup, so regressions can
+ * be attributed and tracked:
+ *
+ *   small_map         get() hits in a map that fits into the caches: the fixed cost of hashing, the modulo of the
+ *                     index computation and the two lock acquisitions
+ *   large_map         get() hits in a map far larger than the last level cache: the pointer chase from the row to its
+ *                     mutex and along the HashNode chain, each a likely cache miss
+ *   long_chains       get() hits with about CHAIN_LENGTH nodes per row: the cost of walking the chain
+ *   misses            get() of absent keys in the small map
+ *   hot_key           every thread reads the same key: the shared lock's cache line bounces between the cores
+ *   hot_key_writes    every thread writes the same key: exclusive lock contention
+ *
+ * Counters the kernel does not provide are reported as n/a, e.g. in virtual machines without a virtual PMU.
+ *
+ * Build: g++ -std=c++14 -O2 -I include -I bench bench/PerfCounterBenchmark.cpp -o PerfCounterBenchmark -lpthread
+ * Usage: PerfCounterBenchmark [operationsPerThread] [maxThreads] [largeMapEntries]
+ */
+
+#include <BenchmarkSupport.hpp>
+#include <HashMap.hpp>
+#include <PerfCounters.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    const long SMALL_MAP_ENTRIES = 1000;
+
+    const long CHAIN_LENGTH = 64;
+
+    enum Scenario {
+        SMALL_MAP, LARGE_MAP, LONG_CHAINS, MISSES, HOT_KEY, HOT_KEY_WRITES
+    };
+
+    const char * const SCENARIO_NAMES[] = { "small_map", "large_map", "long_chains", "misses", "hot_key",
+            "hot_key_writes" };
+
+    // builds a map with the keys [0, entries) and the given row count
+    unique_ptr<HashMap<long, long> > buildMap(const long entries, const int rowCount) {
+        unique_ptr<HashMap<long, long> > map(new HashMap<long, long>(rowCount));
+        for (long key = 0; key < entries; key++) {
+            map->put(key, key);
+        }
+        return map;
+    }
+
+    void run(const Scenario scenario, const int threadCount, const long operationsPerThread,
+            const long largeMapEntries) {
+        long entries = SMALL_MAP_ENTRIES;
+        int rowCount = SMALL_MAP_ENTRIES;
+        if (scenario == LARGE_MAP) {
+            entries = rowCount = largeMapEntries;
+        } else if (scenario == LONG_CHAINS) {
+            rowCount = SMALL_MAP_ENTRIES / CHAIN_LENGTH;
+        }
+        const auto map = buildMap(entries, rowCount);
+
+        // the keys are drawn beforehand, so the counters only see the map operations
+        vector<vector<long> > keys(threadCount);
+        for (int t = 0; t < threadCount; t++) {
+            bench::Random random(t + 1);
+            uniform_int_distribution<long> distribution(0, entries - 1);
+            keys[t].reserve(operationsPerThread);
+            for (long i = 0; i < operationsPerThread; i++) {
+                if (scenario == HOT_KEY || scenario == HOT_KEY_WRITES) {
+                    keys[t].push_back(0);
+                } else if (scenario == MISSES) {
+                    keys[t].push_back(entries + distribution(random));
+                } else {
+                    keys[t].push_back(distribution(random));
+                }
+            }
+        }
+
+        bench::PerfCounters counters;
+        counters.start();
+        const double seconds = bench::runThreads(threadCount, [&](const int t) {
+            long value;
+            for (const long key : keys[t]) {
+                if (scenario == HOT_KEY_WRITES) {
+                    map->put(key, t);
+                } else {
+                    map->get(key, value);
+                }
+            }
+        });
+        counters.stop();
+
+        const double operations = static_cast<double>(threadCount) * operationsPerThread;
+        cout << SCENARIO_NAMES[scenario] << "," << threadCount << "," << static_cast<long>(operations) << ","
+                << seconds * 1e9 * threadCount / operations;
+        for (int i = 0; i < bench::PerfCounters::COUNTER_COUNT; i++) {
+            const auto counter = static_cast<bench::PerfCounters::Counter>(i);
+            cout << ",";
+            if (counters.isAvailable(counter)) {
+                cout << counters.value(counter) / operations;
+            } else {
+                cout << "n/a";
+            }
+        }
+        cout << endl;
+    }
+}
+
+int main(int argc, const char * argv[]) {
+    const long operationsPerThread = argc > 1 ? atol(argv[1]) : 1000000;
+    const int maxThreads = argc > 2 ? atoi(argv[2]) : max(1u, thread::hardware_concurrency());
+    const long largeMapEntries = argc > 3 ? atol(argv[3]) : 4000000;
+
+    // ns_per_op is the thread time per operation (wall clock time times thread count)
+    cout << "scenario,threads,operations,ns_per_op";
+    for (int i = 0; i < bench::PerfCounters::COUNTER_COUNT; i++) {
+        cout << "," << bench::PerfCounters::name(static_cast<bench::PerfCounters::Counter>(i)) << "_per_op";
+    }
+    cout << endl;
+
+    for (const auto scenario : { SMALL_MAP, LARGE_MAP, LONG_CHAINS, MISSES, HOT_KEY, HOT_KEY_WRITES }) {
+        for (const int threads : bench::threadCounts(maxThreads)) {
+            run(scenario, threads, operationsPerThread, largeMapEntries);
+        }
+    }
+    return 0;
+}
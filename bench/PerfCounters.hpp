@@ -0,0 +1,117 @@
+/*
+ * PerfCounters.hpp
+ *
+ * Hardware performance counters for the benchmarks, read through the Linux perf_event_open() system call.
+ */
+
+#ifndef PERFCOUNTERS_HPP_
+#define PERFCOUNTERS_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace bench {
+
+    // counts instructions, cycles, L1 data cache read misses, last level cache read misses and branch misses of the
+    // calling thread and of all threads it creates while the counters are open. Threads created before the
+    // constructor are not counted, thus construct the counters before starting the benchmark threads. Counters the
+    // kernel refuses (no PMU in a VM, perf_event_paranoid too high) are reported as unavailable. The kernel multiplexes
+    // the counters if there are more than hardware registers, their values are scaled to the full measuring time
+    class PerfCounters {
+    public:
+
+        enum Counter {
+            INSTRUCTIONS, CYCLES, L1D_READ_MISSES, LLC_READ_MISSES, BRANCH_MISSES, COUNTER_COUNT
+        };
+
+        static const char *name(const Counter counter) {
+            static const char * const NAMES[COUNTER_COUNT] = { "instructions", "cycles", "l1d_read_misses",
+                    "llc_read_misses", "branch_misses" };
+            return NAMES[counter];
+        }
+
+        PerfCounters() {
+            const uint64_t cacheReadMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            mFds[INSTRUCTIONS] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+            mFds[CYCLES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+            mFds[L1D_READ_MISSES] = open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cacheReadMiss);
+            mFds[LLC_READ_MISSES] = open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | cacheReadMiss);
+            mFds[BRANCH_MISSES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+            std::memset(mValues, 0, sizeof(mValues));
+        }
+
+        PerfCounters(const PerfCounters &) = delete;
+        PerfCounters &operator=(const PerfCounters &) = delete;
+
+        ~PerfCounters() {
+            for (const int fd : mFds) {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+            }
+        }
+
+        bool isAvailable(const Counter counter) const {
+            return mFds[counter] >= 0;
+        }
+
+        // resets and starts all counters
+        void start() {
+            for (const int fd : mFds) {
+                if (fd >= 0) {
+                    ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                    ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+                }
+            }
+        }
+
+        // stops all counters and reads their values, threads created after start() have to be joined beforehand
+        void stop() {
+            for (int i = 0; i < COUNTER_COUNT; i++) {
+                mValues[i] = 0;
+                if (mFds[i] < 0) {
+                    continue;
+                }
+                ::ioctl(mFds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+                // value, time enabled, time running
+                uint64_t data[3];
+                if (::read(mFds[i], data, sizeof(data)) == sizeof(data) && data[2] > 0) {
+                    mValues[i] = static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]);
+                }
+            }
+        }
+
+        // value of the counter between the last start() and stop()
+        uint64_t value(const Counter counter) const {
+            return mValues[counter];
+        }
+
+    private:
+
+        static int open(const uint32_t type, const uint64_t config) {
+            perf_event_attr attributes;
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            attributes.type = type;
+            attributes.config = config;
+            attributes.disabled = 1;
+            attributes.inherit = 1;
+            // user space only, which is permitted with the default perf_event_paranoid setting
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            return static_cast<int>(::syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+        }
+
+        int mFds[COUNTER_COUNT];
+
+        uint64_t mValues[COUNTER_COUNT];
+    };
+}
+
+#endif /* PERFCOUNTERS_HPP_ */
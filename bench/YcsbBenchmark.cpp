@@ -0,0 +1,216 @@
+/*
+ * YcsbBenchmark.cpp
+ *
+ * Runs the YCSB core workloads A-F against a HashMap<long, long> with uniform and Zipfian key distributions for 1, 2,
+ * 4, ... maxThreads threads and reports the throughput and the p50/p99/p99.9 latency of every operation type. Further
+ * phases measure remove() and resize(). The workloads follow the YCSB core workload definitions:
+ *
+ *   A  50% read, 50% update           B  95% read, 5% update          C  100% read
+ *   D  95% read, 5% insert (reads prefer the latest inserts)
+ *   E  95% scan, 5% insert            F  50% read, 50% read-modify-write
+ *
+ * The map is unordered, thus a scan reads a run of 1-100 consecutive keys with get(). Every operation is timed
+ * individually, the clock reads add a few tens of nanoseconds to every latency.
+ *
+ * Build: g++ -std=c++14 -O2 -I include -I bench bench/YcsbBenchmark.cpp -o YcsbBenchmark -lpthread
+ * Usage: YcsbBenchmark [recordCount] [operationsPerThread] [maxThreads] [workloads, e.g. ABCDEF]
+ */
+
+#include <BenchmarkSupport.hpp>
+#include <HashMap.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    enum Operation {
+        READ, UPDATE, INSERT, SCAN, READ_MODIFY_WRITE, OPERATION_COUNT
+    };
+
+    const char * const OPERATION_NAMES[OPERATION_COUNT] = { "read", "update", "insert", "scan", "read_modify_write" };
+
+    enum Distribution {
+        UNIFORM, ZIPFIAN, LATEST
+    };
+
+    const char * const DISTRIBUTION_NAMES[] = { "uniform", "zipfian", "latest" };
+
+    struct Workload {
+        char name;
+
+        // proportions in percent in the order of Operation, summing up to 100
+        int proportions[OPERATION_COUNT];
+
+        // D always reads the latest inserts, the others are run with both uniform and Zipfian keys
+        bool latest;
+    };
+
+    const Workload WORKLOADS[] = { { 'A', { 50, 50, 0, 0, 0 }, false }, { 'B', { 95, 5, 0, 0, 0 }, false }, { 'C', {
+            100, 0, 0, 0, 0 }, false }, { 'D', { 95, 0, 5, 0, 0 }, true }, { 'E', { 0, 0, 5, 95, 0 }, false }, { 'F', {
+            50, 0, 0, 0, 50 }, false } };
+
+    const int MAX_SCAN_LENGTH = 100;
+
+    const int RESIZE_REPETITIONS = 5;
+
+    typedef HashMap<long, long> Map;
+
+    // builds a map holding the keys [0, recordCount)
+    Map *loadMap(const long recordCount) {
+        vector<pair<long, long> > records;
+        records.reserve(recordCount);
+        for (long i = 0; i < recordCount; i++) {
+            records.push_back(make_pair(i, i));
+        }
+        return new Map(records.begin(), records.end(), max(1u, thread::hardware_concurrency()));
+    }
+
+    void printRow(const string &workload, const string &distribution, const int threads, const double opsPerSecond,
+            const string &operation, bench::LatencySamples &samples) {
+        cout << workload << "," << distribution << "," << threads << "," << static_cast<long>(opsPerSecond) << ","
+                << operation << "," << samples.count() << "," << samples.percentile(0.5) << ","
+                << samples.percentile(0.99) << "," << samples.percentile(0.999) << endl;
+    }
+
+    void runWorkload(const Workload &workload, const Distribution distribution, const int threadCount,
+            const long recordCount, const long operationsPerThread, const bench::ZipfianGenerator &zipfian) {
+        unique_ptr<Map> map(loadMap(recordCount));
+        atomic<long> nextInsertKey(recordCount);
+        vector<vector<bench::LatencySamples> > samples(threadCount, vector<bench::LatencySamples>(OPERATION_COUNT));
+
+        const double seconds = bench::runThreads(threadCount, [&](const int t) {
+            bench::Random random(t + 1);
+            bench::ZipfianGenerator keyRanks(zipfian);
+            uniform_int_distribution<int> percent(0, 99);
+            uniform_int_distribution<int> scanLength(1, MAX_SCAN_LENGTH);
+            vector<bench::LatencySamples> &threadSamples = samples[t];
+
+            auto nextKey = [&]() -> long {
+                const long keyCount = nextInsertKey.load(memory_order_relaxed);
+                switch (distribution) {
+                case ZIPFIAN:
+                    return bench::scramble(keyRanks.next(random), keyCount);
+                case LATEST:
+                    return max(0L, keyCount - 1 - static_cast<long>(keyRanks.next(random)));
+                default:
+                    return uniform_int_distribution<long>(0, keyCount - 1)(random);
+                }
+            };
+
+            long value;
+            for (long i = 0; i < operationsPerThread; i++) {
+                int choice = percent(random);
+                int operation = 0;
+                while (choice >= workload.proportions[operation]) {
+                    choice -= workload.proportions[operation];
+                    operation++;
+                }
+
+                const long key = operation == INSERT ? nextInsertKey.fetch_add(1) : nextKey();
+                const int length = operation == SCAN ? scanLength(random) : 0;
+                threadSamples[operation].add(bench::timed([&]() {
+                    switch (operation) {
+                    case READ:
+                        map->get(key, value);
+                        break;
+                    case UPDATE:
+                    case INSERT:
+                        map->put(key, i);
+                        break;
+                    case SCAN:
+                        for (long k = key; k < key + length; k++) {
+                            map->get(k, value);
+                        }
+                        break;
+                    case READ_MODIFY_WRITE:
+                        map->get(key, value);
+                        map->put(key, value + 1);
+                        break;
+                    }
+                }));
+            }
+        });
+
+        const double opsPerSecond = threadCount * operationsPerThread / seconds;
+        for (int operation = 0; operation < OPERATION_COUNT; operation++) {
+            bench::LatencySamples merged;
+            for (auto &threadSamples : samples) {
+                merged.addAll(threadSamples[operation]);
+            }
+            if (merged.count() > 0) {
+                printRow(string(1, workload.name), DISTRIBUTION_NAMES[distribution], threadCount, opsPerSecond,
+                        OPERATION_NAMES[operation], merged);
+            }
+        }
+    }
+
+    // every thread removes an interleaved share of all keys
+    void runRemove(const int threadCount, const long recordCount) {
+        unique_ptr<Map> map(loadMap(recordCount));
+        vector<bench::LatencySamples> samples(threadCount);
+        const double seconds = bench::runThreads(threadCount, [&](const int t) {
+            for (long key = t; key < recordCount; key += threadCount) {
+                samples[t].add(bench::timed([&]() {
+                    map->remove(key);
+                }));
+            }
+        });
+
+        bench::LatencySamples merged;
+        for (auto &threadSamples : samples) {
+            merged.addAll(threadSamples);
+        }
+        printRow("-", "sequential", threadCount, recordCount / seconds, "remove", merged);
+    }
+
+    // doubles and halves the row count of a loaded map, threadCount is the number of resize workers
+    void runResize(const int threadCount, const long recordCount) {
+        unique_ptr<Map> map(loadMap(recordCount));
+        bench::LatencySamples samples;
+        for (int i = 0; i < RESIZE_REPETITIONS; i++) {
+            samples.add(bench::timed([&]() {
+                map->resize(2 * recordCount, threadCount);
+            }));
+            samples.add(bench::timed([&]() {
+                map->resize(recordCount, threadCount);
+            }));
+        }
+        printRow("-", "-", threadCount, 1e9 / samples.percentile(0.5), "resize", samples);
+    }
+}
+
+int main(int argc, const char * argv[]) {
+    const long recordCount = argc > 1 ? atol(argv[1]) : 100000;
+    const long operationsPerThread = argc > 2 ? atol(argv[2]) : 100000;
+    const int maxThreads = argc > 3 ? atoi(argv[3]) : max(1u, thread::hardware_concurrency());
+    const string workloads = argc > 4 ? argv[4] : "ABCDEF";
+
+    const bench::ZipfianGenerator zipfian(recordCount);
+
+    cout << "workload,distribution,threads,ops_per_sec,operation,count,p50_ns,p99_ns,p999_ns" << endl;
+    for (const auto &workload : WORKLOADS) {
+        if (workloads.find(workload.name) == string::npos) {
+            continue;
+        }
+        for (const int threads : bench::threadCounts(maxThreads)) {
+            if (workload.latest) {
+                runWorkload(workload, LATEST, threads, recordCount, operationsPerThread, zipfian);
+            } else {
+                runWorkload(workload, UNIFORM, threads, recordCount, operationsPerThread, zipfian);
+                runWorkload(workload, ZIPFIAN, threads, recordCount, operationsPerThread, zipfian);
+            }
+        }
+    }
+
+    for (const int threads : bench::threadCounts(maxThreads)) {
+        runRemove(threads, recordCount);
+        runResize(threads, recordCount);
+    }
+    return 0;
+}
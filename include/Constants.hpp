@@ -11,6 +11,18 @@
 namespace constants {
     const int TABLE_SIZE = 100;
 
+    // number of worker threads used by resize() if the caller does not specify one
+    const int RESIZE_THREAD_COUNT = 1;
+
+    // maximum number of entries per row reserve() and the bulk constructor size the table for
+    const int MAX_LOAD_FACTOR = 1;
+
+    // number of rows a worker of parallel_for_each() and parallel_reduce() claims at once
+    const int ROWS_PER_CHUNK = 64;
+
+    // number of independently locked registries get_or_load() spreads its pending loads over
+    const int PENDING_LOAD_STRIPES = 64;
+
     const int MAX_INTEGER_KEY = 100000;
 }
 
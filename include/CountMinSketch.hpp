@@ -0,0 +1,167 @@
+#ifndef COUNTMINSKETCH_HPP_
+#define COUNTMINSKETCH_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// approximate access frequencies for the TinyLFU admission filter of a bounded HashMap. Count-min sketch with four rows
+// of 4-bit saturating counters, 16 counters packed into every 64-bit word. Once the number of recorded accesses reaches
+// the sample size, all counters are halved (aging), so the sketch follows changes of the access pattern. All operations
+// are lock-free, concurrent updates of the same word are resolved by compare-and-swap. Reads are far more frequent than
+// writes, so they are buffered per thread stripe and applied in batches, see recordRead()
+class CountMinSketch {
+public:
+
+    // sizes the sketch for a cache of the given capacity
+    explicit CountMinSketch(const size_t capacity) :
+            mWidth(widthFor(capacity)), mTable(DEPTH * mWidth / COUNTERS_PER_WORD), mSampleSize(
+                    SAMPLE_FACTOR * std::max<size_t>(capacity, 1)), mAdditions(0) {
+        for (auto &word : mTable) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    CountMinSketch(const CountMinSketch &) = delete;
+    CountMinSketch &operator=(const CountMinSketch &) = delete;
+
+    // records an access to the key with the given hash value
+    void increment(const size_t hashValue) {
+        add(hashValue);
+        recordAdditions(1);
+    }
+
+    // records a read of the key with the given hash value. The read is stored in the buffer of the calling thread's
+    // stripe, the thread filling a buffer applies all its reads at once, so the shared counter words and the sample
+    // count are touched once per READ_BUFFER_SIZE reads. Reads arriving while a buffer is applied are dropped, like in
+    // the read buffers of other TinyLFU caches, the estimates only have to be approximate
+    void recordRead(const size_t hashValue) {
+        ReadBuffer &buffer = readBuffer();
+        const unsigned int slot = buffer.count.fetch_add(1, std::memory_order_relaxed);
+        if (slot >= READ_BUFFER_SIZE) {
+            return;
+        }
+        buffer.hashes[slot].store(hashValue, std::memory_order_relaxed);
+        if (slot == READ_BUFFER_SIZE - 1) {
+            for (auto &bufferedHash : buffer.hashes) {
+                add(bufferedHash.load(std::memory_order_relaxed));
+            }
+            recordAdditions(READ_BUFFER_SIZE);
+            buffer.count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // estimated number of accesses to the key with the given hash value since the counters were last halved, at most
+    // 15. Buffered reads are not included yet
+    int estimate(const size_t hashValue) const {
+        int frequency = MAX_COUNT;
+        for (int depth = 0; depth < DEPTH; depth++) {
+            const size_t counter = counterIndex(hashValue, depth);
+            const uint64_t word = mTable[counter / COUNTERS_PER_WORD].load(std::memory_order_relaxed);
+            frequency = std::min(frequency, static_cast<int>((word >> (4 * (counter % COUNTERS_PER_WORD))) & MAX_COUNT));
+        }
+        return frequency;
+    }
+
+private:
+
+    static const unsigned int READ_BUFFER_SIZE = 16;
+
+    static const unsigned int READ_BUFFER_STRIPES = 16;
+
+    // reads buffered by the threads of one stripe, the padding keeps the stripes on separate cache lines
+    struct ReadBuffer {
+        std::atomic<unsigned int> count { 0 };
+        std::atomic<size_t> hashes[READ_BUFFER_SIZE];
+        char padding[64];
+    };
+
+    // buffer of the calling thread's stripe, threads are assigned to the stripes round robin on their first read
+    ReadBuffer &readBuffer() {
+        static std::atomic<unsigned int> nextStripe(0);
+        static thread_local const unsigned int threadStripe = nextStripe.fetch_add(1, std::memory_order_relaxed)
+                % READ_BUFFER_STRIPES;
+        return mReadBuffers[threadStripe];
+    }
+
+    // increments the four counters of the given hash value
+    void add(const size_t hashValue) {
+        for (int depth = 0; depth < DEPTH; depth++) {
+            const size_t counter = counterIndex(hashValue, depth);
+            std::atomic<uint64_t> &word = mTable[counter / COUNTERS_PER_WORD];
+            const int shift = 4 * (counter % COUNTERS_PER_WORD);
+
+            uint64_t current = word.load(std::memory_order_relaxed);
+            while (((current >> shift) & MAX_COUNT) < MAX_COUNT
+                    && !word.compare_exchange_weak(current, current + (uint64_t(1) << shift),
+                            std::memory_order_relaxed)) {
+            }
+        }
+    }
+
+    // counts added accesses towards the sample size and ages the counters once it is reached
+    void recordAdditions(const size_t count) {
+        // every thread finding the sample size reached tries to reset the count to half of it, the one succeeding ages
+        // the counters. Accesses recorded while it halves count towards the next sample, and a count that has run past
+        // the sample size meanwhile is still caught by the next increment
+        size_t additions = mAdditions.fetch_add(count, std::memory_order_relaxed) + count;
+        while (additions >= mSampleSize) {
+            if (mAdditions.compare_exchange_weak(additions, mSampleSize / 2, std::memory_order_relaxed)) {
+                halve();
+                break;
+            }
+        }
+    }
+
+    static const int DEPTH = 4;
+
+    static const size_t COUNTERS_PER_WORD = 16;
+
+    static const int MAX_COUNT = 15;
+
+    // number of recorded accesses per cache entry after which the counters are halved
+    static const size_t SAMPLE_FACTOR = 10;
+
+    // counters per row, a power of two with at least four counters per cache entry so that the estimates of the few
+    // keys worth caching are rarely inflated by collisions with the many keys that are not
+    static size_t widthFor(const size_t capacity) {
+        size_t width = 64;
+        while (width < 4 * capacity) {
+            width *= 2;
+        }
+        return width;
+    }
+
+    // index of the counter for the given hash value within the whole table, every row uses a different mixing seed
+    size_t counterIndex(const size_t hashValue, const int depth) const {
+        static const uint64_t SEEDS[DEPTH] = { 0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL,
+                0xd6e8feb86659fd93ULL };
+        uint64_t mixed = (hashValue + SEEDS[depth]) * 0xbf58476d1ce4e5b9ULL;
+        mixed ^= mixed >> 31;
+        return depth * mWidth + (mixed & (mWidth - 1));
+    }
+
+    // halves all counters by shifting every word and dropping the bits moving into the neighbouring counter
+    void halve() {
+        for (auto &word : mTable) {
+            uint64_t current = word.load(std::memory_order_relaxed);
+            while (!word.compare_exchange_weak(current, (current >> 1) & 0x7777777777777777ULL,
+                    std::memory_order_relaxed)) {
+            }
+        }
+    }
+
+    const size_t mWidth;
+
+    std::vector<std::atomic<uint64_t> > mTable;
+
+    const size_t mSampleSize;
+
+    std::atomic<size_t> mAdditions;
+
+    ReadBuffer mReadBuffers[READ_BUFFER_STRIPES];
+};
+
+#endif /* COUNTMINSKETCH_HPP_ */
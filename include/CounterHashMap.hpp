@@ -0,0 +1,220 @@
+#ifndef COUNTERHASHMAP_HPP_
+#define COUNTERHASHMAP_HPP_
+
+#include "Constants.hpp"
+#include "HashMap.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+// integral counter that is incremented in place. Copies load the value, so it can be stored in a HashMap. add() is
+// const, because HashMap hands out the values of its entries as const references
+template<typename T>
+class AtomicCounter {
+    static_assert(std::is_integral<T>::value, "counters have to be integral");
+
+public:
+    AtomicCounter(const T value = 0) :
+            mValue(value) {
+    }
+
+    AtomicCounter(const AtomicCounter &other) :
+            mValue(other.load()) {
+    }
+
+    AtomicCounter &operator=(const AtomicCounter &other) {
+        mValue.store(other.load(), std::memory_order_relaxed);
+        return *this;
+    }
+
+    T load() const {
+        return mValue.load(std::memory_order_relaxed);
+    }
+
+    // adds delta and returns the new value
+    T add(const T delta) const {
+        return mValue.fetch_add(delta, std::memory_order_relaxed) + delta;
+    }
+
+private:
+    mutable std::atomic<T> mValue;
+};
+
+// map of counters for counting workloads. increment() of a present key is a single fetch_add under the shared row
+// lock, so increments of the same row proceed in parallel. Only the first increment of a key takes the row lock
+// exclusively to insert it. Threads hammering a few hot keys pre-aggregate their increments with a Combiner. Snapshots
+// and the write-ahead log are not offered, because they would miss the in-place increments
+template<typename K, typename T = int64_t, typename F = std::hash<K> >
+class CounterHashMap {
+public:
+
+    // pre-aggregates the increments of one thread: deltas are summed per key in a small local open addressing table,
+    // which is reused across batches without allocating, and added to the map in a batch once maxKeys distinct keys are
+    // buffered, once the oldest buffered delta is older than maxDelay (checked on every CLOCK_CHECK_INTERVAL-th
+    // increment), on flush() and on destruction. Hot keys thus cost one map update per batch instead of one per
+    // increment, at the price of readers of the map seeing buffered deltas late. A combiner is not thread-safe, every
+    // thread uses its own. A thread that stops incrementing keeps its deltas until it calls flush() or destroys the
+    // combiner
+    class Combiner {
+    public:
+        static const int CLOCK_CHECK_INTERVAL = 16;
+
+        explicit Combiner(CounterHashMap &map, const size_t maxKeys = 64,
+                const std::chrono::milliseconds maxDelay = std::chrono::milliseconds(10)) :
+                mMap(map), mMaxKeys(std::max<size_t>(maxKeys, 1)), mMaxDelay(maxDelay), mSlots(
+                        slotCountFor(mMaxKeys)), mIncrements(0) {
+            mUsedSlots.reserve(mMaxKeys);
+        }
+
+        Combiner(const Combiner &) = delete;
+        Combiner &operator=(const Combiner &) = delete;
+
+        ~Combiner() {
+            flush();
+        }
+
+        void increment(const K &key, const T delta = 1) {
+            if (mUsedSlots.empty()) {
+                mOldest = std::chrono::steady_clock::now();
+            }
+            const size_t mask = mSlots.size() - 1;
+            size_t index = mHashFunc(key) & mask;
+            // the table is at most half full, an empty slot ends the probing
+            while (mSlots[index].used && !(mSlots[index].key == key)) {
+                index = (index + 1) & mask;
+            }
+            Slot &slot = mSlots[index];
+            if (!slot.used) {
+                slot.used = true;
+                slot.key = key;
+                slot.delta = 0;
+                mUsedSlots.push_back(index);
+            }
+            slot.delta += delta;
+
+            if (mUsedSlots.size() >= mMaxKeys) {
+                flush();
+            } else if (++mIncrements % CLOCK_CHECK_INTERVAL == 0
+                    && std::chrono::steady_clock::now() - mOldest >= mMaxDelay) {
+                flush();
+            }
+        }
+
+        // adds all buffered deltas to the map
+        void flush() {
+            for (const size_t index : mUsedSlots) {
+                Slot &slot = mSlots[index];
+                if (slot.delta != 0) {
+                    mMap.increment(slot.key, slot.delta);
+                }
+                slot.used = false;
+            }
+            mUsedSlots.clear();
+        }
+
+        // number of distinct keys buffered
+        size_t pending() const {
+            return mUsedSlots.size();
+        }
+
+    private:
+        struct Slot {
+            K key;
+            T delta = 0;
+            bool used = false;
+        };
+
+        // smallest power of two keeping maxKeys buffered keys at a load factor of at most 1/2
+        static size_t slotCountFor(const size_t maxKeys) {
+            size_t slotCount = 2;
+            while (slotCount < 2 * maxKeys) {
+                slotCount *= 2;
+            }
+            return slotCount;
+        }
+
+        CounterHashMap &mMap;
+
+        const size_t mMaxKeys;
+
+        const std::chrono::milliseconds mMaxDelay;
+
+        F mHashFunc;
+
+        std::vector<Slot> mSlots;
+
+        // indices of the slots in use, in the order of their first increment
+        std::vector<size_t> mUsedSlots;
+
+        // time of the first increment buffered since the last flush
+        std::chrono::steady_clock::time_point mOldest;
+
+        unsigned int mIncrements;
+    };
+
+    explicit CounterHashMap(const int size = constants::TABLE_SIZE) :
+            mMap(size) {
+    }
+
+    // adds delta to the counter of key, a missing key is inserted with delta. Returns the new value
+    T increment(const K &key, const T delta = 1) {
+        while (true) {
+            T result;
+            if (mMap.updateShared(key, [&](const AtomicCounter<T> &counter) {
+                result = counter.add(delta);
+            })) {
+                return result;
+            }
+            if (mMap.put_if_absent(key, AtomicCounter<T>(delta))) {
+                return delta;
+            }
+            // another thread has inserted the key meanwhile
+        }
+    }
+
+    bool get(const K &key, T &value) {
+        AtomicCounter<T> counter;
+        if (!mMap.get(key, counter)) {
+            return false;
+        }
+        value = counter.load();
+        return true;
+    }
+
+    bool contains(const K &key) {
+        return mMap.contains(key);
+    }
+
+    void remove(const K &key) {
+        mMap.remove(key);
+    }
+
+    void clear() {
+        mMap.clear();
+    }
+
+    int size() {
+        return mMap.size();
+    }
+
+    void resize(const int newTableRowCount, const int threadCount = constants::RESIZE_THREAD_COUNT) {
+        mMap.resize(newTableRowCount, threadCount);
+    }
+
+    // calls fn(key, value) for every counter, see HashMap::for_each()
+    template<typename Fn>
+    void for_each(Fn fn) {
+        mMap.for_each([&](const K &key, const AtomicCounter<T> &counter) {
+            fn(key, counter.load());
+        });
+    }
+
+private:
+    HashMap<K, AtomicCounter<T>, F> mMap;
+};
+
+#endif /* COUNTERHASHMAP_HPP_ */
@@ -0,0 +1,58 @@
+#ifndef EXPIRYSWEEPER_HPP_
+#define EXPIRYSWEEPER_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// calls map.expire(rowBudget) every interval on a background thread, so expired entries of keys that are never read
+// again are reclaimed. Every call visits rowBudget rows and locks one row at a time, a full pass over the table takes
+// rowCount / rowBudget intervals. The thread is stopped by the destructor, which has to run before the map is destroyed
+template<typename Map>
+class ExpirySweeper {
+public:
+    ExpirySweeper(Map &map, const std::chrono::milliseconds interval, const int rowBudget) :
+            mMap(map), mInterval(interval), mRowBudget(rowBudget), mStopped(false), mThread(&ExpirySweeper::run, this) {
+    }
+
+    ExpirySweeper(const ExpirySweeper &) = delete;
+    ExpirySweeper &operator=(const ExpirySweeper &) = delete;
+
+    ~ExpirySweeper() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopped = true;
+        }
+        mStopCondition.notify_one();
+        mThread.join();
+    }
+
+private:
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mStopCondition.wait_for(lock, mInterval, [this]() {
+            return mStopped;
+        })) {
+            lock.unlock();
+            mMap.expire(mRowBudget);
+            lock.lock();
+        }
+    }
+
+    Map &mMap;
+
+    const std::chrono::milliseconds mInterval;
+
+    const int mRowBudget;
+
+    // set by the destructor, guarded by mMutex
+    bool mStopped;
+    std::mutex mMutex;
+    std::condition_variable mStopCondition;
+
+    std::thread mThread;
+};
+
+#endif /* EXPIRYSWEEPER_HPP_ */
@@ -0,0 +1,274 @@
+#ifndef FLATINTEGERHASHMAP_HPP_
+#define FLATINTEGERHASHMAP_HPP_
+
+#include "Constants.hpp"
+#include "HashFunctions.hpp"
+#include "HashMap.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <thread>
+#include <type_traits>
+
+// HashMap variant for integral keys and values without node allocation: the key-value pairs are stored directly in a
+// flat, cache line aligned array of slots probed linearly. A slot is claimed by a compare-and-swap of its key from
+// EMPTY_KEY to BUSY_KEY, filled and published by storing the key, thus put() needs no row lock and get() none at all.
+// remove() replaces the key by REMOVED_KEY, removed slots are reclaimed when the table grows. The map lock is only
+// taken exclusively to grow the table or to clear it. The three largest values of K are reserved as sentinels, put()
+// returns false for them. Unlike HashMap there are no snapshots, write-ahead log, expiry, capacity bound or iterators
+template<typename K, typename V, typename F = IntegerHash>
+class FlatIntegerHashMap {
+    static_assert(std::is_integral<K>::value && !std::is_same<K, bool>::value, "keys have to be integral");
+    static_assert(std::is_integral<V>::value, "values have to be integral");
+
+public:
+    static constexpr K EMPTY_KEY = std::numeric_limits<K>::max();
+    static constexpr K BUSY_KEY = EMPTY_KEY - 1;
+    static constexpr K REMOVED_KEY = EMPTY_KEY - 2;
+
+    // sizes the table for the given number of entries, it grows beyond on demand
+    explicit FlatIntegerHashMap(const size_t capacity = constants::TABLE_SIZE) :
+            mSlots(NULL), mSlotCount(0), mSize(0), mUsed(0) {
+        allocateSlots(slotCountFor(capacity));
+    }
+
+    FlatIntegerHashMap(const FlatIntegerHashMap &) = delete;
+    FlatIntegerHashMap &operator=(const FlatIntegerHashMap &) = delete;
+
+    ~FlatIntegerHashMap() {
+        std::free(mSlots);
+    }
+
+    // returns false if key is one of the sentinels
+    static bool isValidKey(const K key) {
+        return key < REMOVED_KEY;
+    }
+
+    bool get(const K key, V &value) {
+        std::shared_lock < std::shared_timed_mutex > sharedMapLock(mMapMutex);
+        const Slot *slot = find(key);
+        if (slot == NULL) {
+            return false;
+        }
+        value = slot->value.load(std::memory_order_acquire);
+        return true;
+    }
+
+    bool contains(const K key) {
+        std::shared_lock < std::shared_timed_mutex > sharedMapLock(mMapMutex);
+        return find(key) != NULL;
+    }
+
+    // inserts or updates the entry, returns false if key is reserved as a sentinel
+    bool put(const K key, const V value) {
+        if (!isValidKey(key)) {
+            return false;
+        }
+        while (true) {
+            {
+                std::shared_lock < std::shared_timed_mutex > sharedMapLock(mMapMutex);
+                if (mUsed.load(std::memory_order_relaxed) < maxUsed(mSlotCount) && tryPut(key, value)) {
+                    return true;
+                }
+            }
+            grow();
+        }
+    }
+
+    void remove(const K key) {
+        std::shared_lock < std::shared_timed_mutex > sharedMapLock(mMapMutex);
+        Slot *slot = find(key);
+        if (slot != NULL) {
+            // fails if a concurrent remove() has been faster
+            K expected = key;
+            if (slot->key.compare_exchange_strong(expected, REMOVED_KEY, std::memory_order_acq_rel)) {
+                mSize.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void clear() {
+        const std::lock_guard<std::shared_timed_mutex> exclusiveMapLock(mMapMutex);
+        for (size_t i = 0; i < mSlotCount; i++) {
+            mSlots[i].key.store(EMPTY_KEY, std::memory_order_relaxed);
+        }
+        mSize = 0;
+        mUsed = 0;
+    }
+
+    int size() {
+        return static_cast<int>(mSize.load(std::memory_order_relaxed));
+    }
+
+    // calls fn(key, value) for every entry, entries put or removed concurrently may or may not be visited
+    template<typename Fn>
+    void for_each(Fn fn) {
+        std::shared_lock < std::shared_timed_mutex > sharedMapLock(mMapMutex);
+        for (size_t i = 0; i < mSlotCount; i++) {
+            const K key = mSlots[i].key.load(std::memory_order_acquire);
+            if (isValidKey(key)) {
+                fn(key, mSlots[i].value.load(std::memory_order_acquire));
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        std::atomic<K> key;
+        std::atomic<V> value;
+    };
+
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    static const size_t MIN_SLOT_COUNT = 16;
+
+    // smallest power of two keeping the load factor of capacity entries at or below 1/2
+    static size_t slotCountFor(const size_t capacity) {
+        size_t slotCount = MIN_SLOT_COUNT;
+        while (slotCount < 2 * capacity) {
+            slotCount *= 2;
+        }
+        return slotCount;
+    }
+
+    // the table grows once 3/4 of its slots have been claimed, including removed ones
+    static size_t maxUsed(const size_t slotCount) {
+        return slotCount / 4 * 3;
+    }
+
+    // returns the slot holding key or NULL, the caller has to hold the map lock
+    Slot *find(const K key) {
+        if (!isValidKey(key)) {
+            return NULL;
+        }
+        const size_t mask = mSlotCount - 1;
+        size_t index = mHashFunc(key) & mask;
+        for (size_t probes = 0; probes < mSlotCount; probes++) {
+            const K current = mSlots[index].key.load(std::memory_order_acquire);
+            if (current == key) {
+                return &mSlots[index];
+            }
+            if (current == EMPTY_KEY) {
+                return NULL;
+            }
+            // removed slots and slots being filled with another key (or key by a concurrent put()) are skipped
+            index = (index + 1) & mask;
+        }
+        return NULL;
+    }
+
+    // updates the slot holding key or claims the first empty slot of its probe sequence. Returns false if the probe
+    // sequence has no empty slot left, the caller has to hold the map lock
+    bool tryPut(const K key, const V value) {
+        const size_t mask = mSlotCount - 1;
+        size_t index = mHashFunc(key) & mask;
+        for (size_t probes = 0; probes < mSlotCount; probes++) {
+            Slot &slot = mSlots[index];
+            K current = slot.key.load(std::memory_order_acquire);
+            if (current == EMPTY_KEY
+                    && slot.key.compare_exchange_strong(current, BUSY_KEY, std::memory_order_acquire)) {
+                mUsed.fetch_add(1, std::memory_order_relaxed);
+                slot.value.store(value, std::memory_order_relaxed);
+                mSize.fetch_add(1, std::memory_order_relaxed);
+                // publishes the value together with the key
+                slot.key.store(key, std::memory_order_release);
+                return true;
+            }
+
+            // a slot being filled may receive key, so a concurrent put() of the same key has to wait for the result
+            // instead of claiming another slot
+            while (current == BUSY_KEY) {
+                std::this_thread::yield();
+                current = slot.key.load(std::memory_order_acquire);
+            }
+            if (current == key) {
+                slot.value.store(value, std::memory_order_release);
+                return true;
+            }
+            index = (index + 1) & mask;
+        }
+        return false;
+    }
+
+    // rehashes the entries into a table sized for twice their number, dropping the removed slots
+    void grow() {
+        const std::lock_guard<std::shared_timed_mutex> exclusiveMapLock(mMapMutex);
+        if (mUsed.load(std::memory_order_relaxed) < maxUsed(mSlotCount)) {
+            // another thread has grown the table meanwhile
+            return;
+        }
+
+        Slot *oldSlots = mSlots;
+        const size_t oldSlotCount = mSlotCount;
+        allocateSlots(slotCountFor(mSize.load(std::memory_order_relaxed) + 1));
+
+        const size_t mask = mSlotCount - 1;
+        for (size_t i = 0; i < oldSlotCount; i++) {
+            const K key = oldSlots[i].key.load(std::memory_order_relaxed);
+            if (!isValidKey(key)) {
+                continue;
+            }
+            size_t index = mHashFunc(key) & mask;
+            while (mSlots[index].key.load(std::memory_order_relaxed) != EMPTY_KEY) {
+                index = (index + 1) & mask;
+            }
+            mSlots[index].key.store(key, std::memory_order_relaxed);
+            mSlots[index].value.store(oldSlots[i].value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            mUsed.fetch_add(1, std::memory_order_relaxed);
+        }
+        std::free(oldSlots);
+    }
+
+    // replaces mSlots by an empty table of slotCount slots without releasing the previous one
+    void allocateSlots(const size_t slotCount) {
+        void *memory = NULL;
+        if (::posix_memalign(&memory, CACHE_LINE_SIZE, slotCount * sizeof(Slot)) != 0) {
+            throw std::bad_alloc();
+        }
+        mSlots = static_cast<Slot *>(memory);
+        for (size_t i = 0; i < slotCount; i++) {
+            new (&mSlots[i]) Slot();
+            mSlots[i].key.store(EMPTY_KEY, std::memory_order_relaxed);
+            mSlots[i].value.store(0, std::memory_order_relaxed);
+        }
+        mSlotCount = slotCount;
+        mUsed = 0;
+    }
+
+    Slot *mSlots;
+
+    // always a power of two, the probe start is masked instead of taken modulo
+    size_t mSlotCount;
+
+    F mHashFunc;
+
+    // entries present, updated next to the slots, so it may briefly be off by the operations in flight
+    std::atomic<long> mSize;
+
+    // slots claimed since the table has been allocated or cleared, present and removed ones
+    std::atomic<size_t> mUsed;
+
+    // held shared by all operations, exclusively to grow or clear the table
+    std::shared_timed_mutex mMapMutex;
+};
+
+template<typename K, typename V, typename F>
+constexpr K FlatIntegerHashMap<K, V, F>::EMPTY_KEY;
+
+template<typename K, typename V, typename F>
+constexpr K FlatIntegerHashMap<K, V, F>::BUSY_KEY;
+
+template<typename K, typename V, typename F>
+constexpr K FlatIntegerHashMap<K, V, F>::REMOVED_KEY;
+
+// FlatIntegerHashMap if K and V qualify, HashMap otherwise. Code using the alias is restricted to the interface both
+// share: get(), put(), remove(), contains(), clear(), size() and for_each(), and must not put the reserved keys
+template<typename K, typename V>
+using AutoHashMap = typename std::conditional<std::is_integral<K>::value && !std::is_same<K, bool>::value
+        && std::is_integral<V>::value, FlatIntegerHashMap<K, V>, HashMap<K, V> >::type;
+
+#endif /* FLATINTEGERHASHMAP_HPP_ */
@@ -0,0 +1,170 @@
+#ifndef HASHFUNCTIONS_HPP_
+#define HASHFUNCTIONS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <type_traits>
+
+// hash functions usable as the F parameter of HashMap. All of them take a seed, the same key and seed always give the
+// same hash, different seeds give unrelated hashes. The default seed is 0, see RandomSeeded for a seed per instance
+
+namespace hashing {
+
+    // 64 x 64 -> 128 bit multiplication folded to 64 bits
+    inline uint64_t mix(const uint64_t a, const uint64_t b) {
+#ifdef __SIZEOF_INT128__
+        const __uint128_t product = static_cast<__uint128_t>(a) * b;
+        return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+        const uint64_t aLow = a & 0xffffffff, aHigh = a >> 32;
+        const uint64_t bLow = b & 0xffffffff, bHigh = b >> 32;
+        const uint64_t lowLow = aLow * bLow, lowHigh = aLow * bHigh, highLow = aHigh * bLow, highHigh = aHigh * bHigh;
+        const uint64_t middle = (lowLow >> 32) + (lowHigh & 0xffffffff) + (highLow & 0xffffffff);
+        const uint64_t low = (lowLow & 0xffffffff) | (middle << 32);
+        const uint64_t high = highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+        return low ^ high;
+#endif
+    }
+
+    inline uint64_t read64(const unsigned char *p) {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t read32(const unsigned char *p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    const uint64_t SECRET[4] = { 0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL,
+            0x589965cc75374cc3ULL };
+
+    // wyhash style hash of length bytes. Inputs longer than 48 bytes are consumed 48 bytes at a time by three
+    // independent multiply chains, which the CPU executes in parallel. The seed (or the chain state derived from it) is
+    // mixed into both operands of every multiplication: an operand the key alone can make 0 would zero the product and
+    // drop the seed, so keys colliding under one seed would collide under all of them
+    inline uint64_t hashBytes(const void *data, const size_t length, uint64_t seed) {
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        seed ^= mix(seed ^ SECRET[0], SECRET[1]);
+        uint64_t a;
+        uint64_t b;
+        if (length <= 16) {
+            if (length >= 4) {
+                // two overlapping reads cover 4 to 16 bytes
+                const size_t offset = (length >> 3) << 2;
+                a = (read32(p) << 32) | read32(p + offset);
+                b = (read32(p + length - 4) << 32) | read32(p + length - 4 - offset);
+            } else if (length > 0) {
+                a = (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[length >> 1]) << 8) | p[length - 1];
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            size_t remaining = length;
+            if (remaining > 48) {
+                uint64_t seed1 = seed;
+                uint64_t seed2 = seed;
+                do {
+                    seed = mix(read64(p) ^ SECRET[1] ^ seed, read64(p + 8) ^ seed);
+                    seed1 = mix(read64(p + 16) ^ SECRET[2] ^ seed1, read64(p + 24) ^ seed1);
+                    seed2 = mix(read64(p + 32) ^ SECRET[3] ^ seed2, read64(p + 40) ^ seed2);
+                    p += 48;
+                    remaining -= 48;
+                } while (remaining > 48);
+                seed ^= seed1 ^ seed2;
+            }
+            while (remaining > 16) {
+                seed = mix(read64(p) ^ SECRET[1] ^ seed, read64(p + 8) ^ seed);
+                p += 16;
+                remaining -= 16;
+            }
+            // the last 16 bytes, overlapping the ones already consumed
+            a = read64(p + remaining - 16);
+            b = read64(p + remaining - 8);
+        }
+        return mix(SECRET[1] ^ length, mix(a ^ SECRET[1] ^ seed, b ^ seed));
+    }
+
+    // random seed, distinct for every call even if std::random_device is deterministic on the platform
+    inline uint64_t randomSeed() {
+        static std::atomic<uint64_t> counter(0);
+        std::random_device device;
+        const uint64_t entropy = (static_cast<uint64_t>(device()) << 32) ^ device();
+        const uint64_t time = std::chrono::steady_clock::now().time_since_epoch().count();
+        return mix(entropy ^ SECRET[0], (time + counter.fetch_add(1, std::memory_order_relaxed)) ^ SECRET[2]);
+    }
+}
+
+// strong hash for integral keys. std::hash is the identity for integers in libstdc++, thus keys with a stride sharing
+// a factor with the row count (e.g. multiples of the row count) all land in a few rows. Every bit of the key affects
+// every bit of the hash (finalizer of MurmurHash3)
+struct IntegerHash {
+    explicit IntegerHash(const uint64_t seed = 0) :
+            mSeed(seed) {
+    }
+
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type>
+    size_t operator()(const T key) const {
+        uint64_t x = static_cast<uint64_t>(key) ^ mSeed;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return static_cast<size_t>(x);
+    }
+
+    uint64_t seed() const {
+        return mSeed;
+    }
+
+private:
+    uint64_t mSeed;
+};
+
+// fast hash for std::string keys, several times faster than std::hash for long strings. Transparent like StringHash:
+// std::string, C strings and every type providing data() and size() hash to the same value
+struct FastStringHash {
+    typedef void is_transparent;
+
+    explicit FastStringHash(const uint64_t seed = 0) :
+            mSeed(seed) {
+    }
+
+    template<typename S>
+    size_t operator()(const S &s) const {
+        return static_cast<size_t>(hashing::hashBytes(s.data(), s.size(), mSeed));
+    }
+
+    size_t operator()(const char *s) const {
+        return static_cast<size_t>(hashing::hashBytes(s, std::strlen(s), mSeed));
+    }
+
+    uint64_t seed() const {
+        return mSeed;
+    }
+
+private:
+    uint64_t mSeed;
+};
+
+// hash H seeded randomly on construction, e.g. HashMap<std::string, V, RandomSeeded<FastStringHash> >. Every map gets
+// its own seed, so keys crafted to collide in one map (hash flooding) do not collide in another one and the rows of a
+// map cannot be degraded to long chains by an attacker who does not know the seed. HashMap's save() files and its
+// write-ahead log hold the keys only and are rehashed on loading, but PersistentHashMap and SharedMemoryHashMap store
+// the row of every key and need a hash function that is stable across processes, thus they cannot use a random seed
+template<typename H>
+struct RandomSeeded: H {
+    RandomSeeded() :
+            H(hashing::randomSeed()) {
+    }
+};
+
+#endif /* HASHFUNCTIONS_HPP_ */
@@ -2,195 +2,1553 @@
 #define HASHMAP_HPP_
 
 #include "Constants.hpp"
+#include "CountMinSketch.hpp"
 #include "HashNode.hpp"
+#include "HashMapSnapshot.hpp"
+#include "HashMapStats.hpp"
+#include "Serialization.hpp"
+#include "WriteAheadLog.hpp"
 #include <sstream>
 #include <functional>
 #include <shared_mutex>
 #include <iostream>
 #include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
-// HashMap class template
-template<typename K, typename V, typename F = std::hash<K> >
+template<typename K, typename T, typename F>
+class CounterHashMap;
+
+// HashMap class template. F hashes and E compares the keys, nodes are allocated with A rebound to HashNode<K, V>
+template<typename K, typename V, typename F = std::hash<K>, typename E = std::equal_to<K>,
+        typename A = std::allocator<std::pair<const K, V> > >
 class HashMap {
 public:
 
+    // weakly consistent iterator over the entries of the map. It holds a shared lock on the map until it has reached
+    // the end or has been destroyed (together with all its copies), thus other threads' put() and remove() proceed
+    // while iterating, but resize() and clear() wait. Rows are copied one at a time while holding only that row's
+    // shared lock, hence every entry is returned at most once, while modifications on rows not visited yet may or may
+    // not be seen. Two passes over the map may thus differ, which is why it is an input iterator. The map lock must not
+    // be acquired recursively, so the thread holding an iterator must not call any operation of this map until the
+    // iterator has reached the end
+    class Iterator {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef std::pair<K, V> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const value_type *pointer;
+        typedef const value_type &reference;
+
+        // constructs the end iterator
+        Iterator() :
+                mMap(NULL), mRow(0), mPosition(0) {
+        }
+
+        reference operator*() const {
+            return (*mRowEntries)[mPosition];
+        }
+
+        pointer operator->() const {
+            return &(*mRowEntries)[mPosition];
+        }
+
+        Iterator &operator++() {
+            mPosition++;
+            if (mPosition == mRowEntries->size()) {
+                mRow++;
+                loadNextRow();
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator previous(*this);
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return mMap == other.mMap && mRow == other.mRow && mPosition == other.mPosition;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return !(*this == other);
+        }
+
+    private:
+        friend class HashMap;
+
+        explicit Iterator(HashMap *map) :
+                mMap(map), mMapLock(std::make_shared<std::shared_lock<std::shared_timed_mutex> >(map->mMapMutex)), mRow(
+                        0), mPosition(0) {
+            loadNextRow();
+        }
+
+        // copies the entries of the next non-empty row starting at mRow, turns into the end iterator if there is none
+        void loadNextRow() {
+            // copies of the iterator share the copied row, it is only refilled in place if no copy refers to it
+            if (mRowEntries.use_count() == 1) {
+                mRowEntries->clear();
+            } else {
+                mRowEntries = std::make_shared<std::vector<value_type> >();
+            }
+            mPosition = 0;
+            for (; mRow < mMap->mTableRowCount; mRow++) {
+                std::shared_lock < std::shared_timed_mutex > sharedLock(*mMap->mMutexList[mRow]);
+                for (auto entry = mMap->mTable[mRow]; entry != NULL; entry = entry->getNext()) {
+                    if (!entry->isExpired()) {
+                        mRowEntries->push_back(value_type(entry->getKey(), entry->getValue()));
+                    }
+                }
+                if (!mRowEntries->empty()) {
+                    return;
+                }
+            }
+
+            // no entries left, release this iterator's share of the map lock as early as possible
+            mMap = NULL;
+            mRow = 0;
+            mMapLock.reset();
+            mRowEntries.reset();
+        }
+
+        HashMap *mMap;
+
+        // shared by the copies of the iterator, the map lock is released once the last of them drops it
+        std::shared_ptr<std::shared_lock<std::shared_timed_mutex> > mMapLock;
+
+        // index of the row mRowEntries has been copied from
+        int mRow;
+
+        std::shared_ptr<std::vector<value_type> > mRowEntries;
+
+        size_t mPosition;
+    };
+
+    // approximate memory footprint of a map, see memory_usage(). Allocator overhead is not included
+    struct MemoryUsage {
+        // the map object, the row arrays, the row mutexes and the nodes
+        size_t structure;
+
+        // heap memory owned by the keys and values as reported by the payload sizer, 0 without a sizer
+        size_t payload;
+
+        size_t total() const {
+            return structure + payload;
+        }
+    };
+
     HashMap(int size = constants::TABLE_SIZE) :
             mTableRowCount(size) {
         init();
     }
 
+    // uses the given hash function, key equality and allocator instead of default constructed ones, e.g. for an
+    // allocator drawing from an arena
+    HashMap(int size, const F &hashFunc, const E &keyEqual = E(), const A &allocator = A()) :
+            mHashFunc(hashFunc), mKeyEqual(keyEqual), mNodeAllocator(allocator), mTableRowCount(size) {
+        init();
+    }
+
+    // bulk constructor, builds the map from the key-value pairs in [first, last). The table is presized for the number of
+    // pairs and filled without row locking, because the map is not shared yet. With threadCount > 1 the range is split
+    // into one slice per worker thread. Every worker hashes the pairs of its slice once and sorts them by the worker
+    // owning their row, then every worker links the pairs of its rows, taking the slices in range order. The range is
+    // thus traversed three times and has to be a forward range. If a key occurs repeatedly, the last pair wins. The
+    // constructor only takes part in overload resolution for forward iterators, so HashMap(size, hashFunc) is not
+    // mistaken for a range if the hash function converts from int
+    template<typename ForwardIt, typename = typename std::enable_if<
+            std::is_base_of<std::forward_iterator_tag,
+                    typename std::iterator_traits<ForwardIt>::iterator_category>::value>::type>
+    HashMap(ForwardIt first, ForwardIt last, const int threadCount = constants::RESIZE_THREAD_COUNT) :
+            mTableRowCount(rowCountFor(std::distance(first, last))) {
+        init();
+
+        const long count = std::distance(first, last);
+        const int workerCount = std::max(1, std::min(threadCount, mTableRowCount));
+        if (workerCount == 1) {
+            for (auto it = first; it != last; ++it) {
+                if (insertIntoRow(mHashFunc(it->first) % mTableRowCount, it->first, it->second)) {
+                    mSize++;
+                }
+            }
+            return;
+        }
+
+        // one walk finds the start of every slice, sliceStarts[workerCount] is the end of the range
+        std::vector<ForwardIt> sliceStarts(1, first);
+        for (int worker = 0; worker < workerCount; worker++) {
+            auto sliceEnd = sliceStarts.back();
+            std::advance(sliceEnd, count * (worker + 1) / workerCount - count * worker / workerCount);
+            sliceStarts.push_back(sliceEnd);
+        }
+
+        // scattered[source][target] holds the pairs of the source's slice falling into the target's rows together with
+        // their row, in range order. Worker t owns the rows whose index * workerCount / mTableRowCount is t
+        typedef std::vector<std::pair<ForwardIt, int> > ScatteredPairs;
+        std::vector<std::vector<ScatteredPairs> > scattered(workerCount, std::vector<ScatteredPairs>(workerCount));
+
+        // one single-row partition per worker, the partition index serves as worker index
+        runPartitioned(workerCount, workerCount, [&](const int worker, const int) {
+            for (auto it = sliceStarts[worker]; it != sliceStarts[worker + 1]; ++it) {
+                const int index = mHashFunc(it->first) % mTableRowCount;
+                scattered[worker][static_cast<long>(index) * workerCount / mTableRowCount].emplace_back(it, index);
+            }
+        });
+        runPartitioned(workerCount, workerCount, [&](const int worker, const int) {
+            int insertedCount = 0;
+            for (int source = 0; source < workerCount; source++) {
+                for (const auto &pair : scattered[source][worker]) {
+                    if (this->insertIntoRow(pair.second, pair.first->first, pair.first->second)) {
+                        insertedCount++;
+                    }
+                }
+            }
+            mSize += insertedCount;
+        });
+    }
+
     ~HashMap() {
+        detachSnapshots();
         purge();
     }
 
+    // returns false if the key is not present or its entry has expired, an expired entry is reclaimed right away
     bool get(const K &key, V &value) {
-        // acquire read lock for map instance
+        return getByKey(key, value);
+    }
+
+    // heterogeneous lookup, only available if both the hash function and the key equality declare is_transparent: key
+    // may be of any type they accept, e.g. a const char * for std::string keys with StringHash and std::equal_to<>,
+    // so no temporary K is constructed. The hash of key has to match the hash of the equal K
+    template<typename Q, typename Hash = F, typename Equal = E, typename = typename Hash::is_transparent,
+            typename = typename Equal::is_transparent>
+    bool get(const Q &key, V &value) {
+        return getByKey(key, value);
+    }
+
+    // read-through lookup: returns the value of key and calls loader(key, value) to load and insert it on a miss. The
+    // loader returns false if the key does not exist, then nothing is inserted and false is returned. Concurrent misses
+    // of the same key are coalesced (single flight): the first caller registers a pending load and runs the loader
+    // without holding any lock, the others wait for its result instead of calling the loader themselves. The loader
+    // must not access this map. If it throws, the waiting callers return false and the exception is passed on to the
+    // caller that ran it
+    template<typename Loader>
+    bool get_or_load(const K &key, V &value, Loader loader) {
+        if (get(key, value)) {
+            return true;
+        }
+
+        std::shared_ptr<PendingLoad> pending;
+        bool leader = false;
+        {
+            PendingStripe &stripe = pendingStripeOf(key);
+            std::lock_guard<std::mutex> pendingLock(stripe.mMutex);
+
+            // a load that completed since the miss has inserted its value before unregistering. The miss has already
+            // been recorded by the admission filter, as has the put() of the loaded value
+            bool expired;
+            if (getInternal(key, value, expired, false)) {
+                return true;
+            }
+            auto &slot = stripe.mLoads[key];
+            if (!slot) {
+                slot = std::make_shared<PendingLoad>();
+                leader = true;
+            }
+            pending = slot;
+        }
+
+        if (!leader) {
+            std::unique_lock<std::mutex> lock(pending->mMutex);
+            pending->mCompleted.wait(lock, [&]() {
+                return pending->mDone;
+            });
+            if (pending->mFound) {
+                value = pending->mValue;
+            }
+            return pending->mFound;
+        }
+
+        bool found;
+        try {
+            found = loader(key, value);
+            if (found) {
+                // waiters are served from the pending load, even if a bounded map rejects the value
+                putWithExpiry(key, value, HashNode<K, V>::NEVER, false, false);
+            }
+        } catch (...) {
+            completeLoad(key, *pending, false, value);
+            throw;
+        }
+        completeLoad(key, *pending, found, value);
+        return found;
+    }
+
+    bool contains(const K &key) {
+        return containsByKey(key);
+    }
+
+    // heterogeneous contains(), see get()
+    template<typename Q, typename Hash = F, typename Equal = E, typename = typename Hash::is_transparent,
+            typename = typename Equal::is_transparent>
+    bool contains(const Q &key) {
+        return containsByKey(key);
+    }
+
+    // external visible function, acquires map global lock before calling the internal put implementation that does the job.
+    // Returns false if the map is bounded and full and its admission filter rejected the new key, or if the attached
+    // write-ahead log failed to make the entry durable, see setWriteAheadLog()
+    bool put(const K &key, const V &value) {
+        return putWithExpiry(key, value, HashNode<K, V>::NEVER);
+    }
+
+    // like put(), but the entry expires after ttl: get() and contains() no longer find it and the memory is reclaimed
+    // by the next get() of the key, by expire() or by the eviction of a bounded map. Expired entries count towards
+    // size() until they are reclaimed. Another put() of the key replaces the expiry. The expiry is not persisted, the
+    // write-ahead log and the files written by save() hold the entries without it
+    bool put(const K &key, const V &value, const std::chrono::milliseconds ttl) {
+        return putWithExpiry(key, value, std::chrono::steady_clock::now() + ttl);
+    }
+
+    // like put(), but only inserts the entry if key is not present (an expired entry counts as absent). Returns false
+    // if key is present or the map rejected the entry
+    bool put_if_absent(const K &key, const V &value) {
+        return putWithExpiry(key, value, HashNode<K, V>::NEVER, true);
+    }
+
+    // returns false if the attached write-ahead log failed to make the removal durable, see setWriteAheadLog()
+    bool remove(const K &key) {
+        return removeByKey(key);
+    }
+
+    // heterogeneous remove(), see get()
+    template<typename Q, typename Hash = F, typename Equal = E, typename = typename Hash::is_transparent,
+            typename = typename Equal::is_transparent>
+    bool remove(const Q &key) {
+        return removeByKey(key);
+    }
+
+    // returns false if the attached write-ahead log failed to make the clearing durable, see setWriteAheadLog()
+    bool clear() {
+        MapLog<K, V> *log;
+        uint64_t lsn = 0;
+        {
+            // acquire write lock for complete map, rows still shared with snapshots are handed over to them before purging
+            const std::lock_guard<std::shared_timed_mutex> exclusiveMapLock(this->mMapMutex);
+            completeSnapshots();
+            purge();
+            init();
+
+            log = mLog;
+            if (log != NULL) {
+                lsn = log->appendClear();
+            }
+        }
+        return syncLog(log, lsn);
+    }
+
+    int size() {
+        return mSize;
+    }
+
+    // rehashes all entries into a table with newTableRowCount rows. The source rows are partitioned among threadCount
+    // worker threads which relink the existing nodes into the new table, so no entry is copied during the rehash
+    void resize(const int newTableRowCount, const int threadCount = constants::RESIZE_THREAD_COUNT) {
+
+#ifdef HASHMAP_STATS
+        const auto start = std::chrono::steady_clock::now();
+#endif
+        // acquire write lock for complete map, no other operations are allowed while resizing is running
+        const std::lock_guard<std::shared_timed_mutex> exclusiveMapLock(this->mMapMutex);
+#ifdef HASHMAP_STATS
+        mStats.mapLockAcquired(start);
+#endif
+
+        // snapshots cannot follow the nodes into the new table, thus they capture all rows they still share beforehand
+        completeSnapshots();
+
+        HashNode<K, V> **newTable;
+        std::shared_timed_mutex **newMutexList;
+        allocateRows(newTableRowCount, newTable, newMutexList);
+
+        runPartitioned(mTableRowCount, threadCount, [&](const int firstRow, const int lastRow) {
+            this->rehashRows(firstRow, lastRow, newTable, newMutexList, newTableRowCount);
+        });
+
+        // all nodes have been moved to the new table, only the old row and mutex arrays have to be released
+        releaseRows(mTableRowCount, mTable, mMutexList);
+        delete[] mRowEpochs;
+
+        mTable = newTable;
+        mMutexList = newMutexList;
+        mTableRowCount = newTableRowCount;
+        mRowEpochs = newRowEpochs(newTableRowCount);
+#ifdef HASHMAP_STATS
+        mStats.resetRows(newTableRowCount);
+        mStats.resized(std::chrono::steady_clock::now() - start);
+#endif
+    }
+
+    // returns an immutable point-in-time view of the map in O(1). Writers are not paused: the first write to a row after
+    // the snapshot hands the row's current chain over to the snapshot and continues on a copy (copy-on-write)
+    HashMapSnapshot<K, V, F, E, A> snapshot() {
+        // the exclusive lock waits for in-flight writers, every writer afterwards sees the new epoch
+        const std::lock_guard<std::shared_timed_mutex> exclusiveMapLock(this->mMapMutex);
+        return snapshotLocked();
+    }
+
+    // writes a consistent snapshot of the map to path in the format described in Serialization.hpp without blocking
+    // writers. The data is written to a temporary file which replaces path once it is durable. Returns false on I/O
+    // errors
+    bool save(const std::string &path) {
+        return saveSnapshot(snapshot(), path);
+    }
+
+    // attaches a write-ahead log (NULL detaches it). Every put(), remove() and clear() is appended to the log while
+    // holding its row lock and returns once the record is durable. Restore the map with recover() before attaching.
+    // Once the log fails to write a record, the change stays applied to the map, but it is not durable: put(),
+    // remove() and clear() return false and checkpoint() fails from then on. Attach a new log and checkpoint the map
+    // to make its content durable again
+    void setWriteAheadLog(WriteAheadLog<K, V> *log) {
+        const std::lock_guard<std::shared_timed_mutex> exclusiveMapLock(this->mMapMutex);
+        mLog = log;
+    }
+
+    // saves the map to path like save() and truncates the attached write-ahead log to the records written after the
+    // snapshot. Snapshot and log rotation happen atomically under the exclusive map lock, writers continue while the
+    // checkpoint is written. Returns false if the checkpoint could not be written or the log has failed, the log is
+    // kept in that case
+    bool checkpoint(const std::string &path) {
+        MapLog<K, V> *log;
+        uint64_t segment = 0;
+        const auto view = [&]() {
+            const std::lock_guard<std::shared_timed_mutex> exclusiveMapLock(this->mMapMutex);
+            log = mLog;
+            if (log != NULL) {
+                segment = log->rotate();
+            }
+            return this->snapshotLocked();
+        }();
+
+        if ((log != NULL && segment == 0) || !saveSnapshot(view, path)) {
+            return false;
+        }
+        if (log != NULL) {
+            log->truncate(segment);
+        }
+        return true;
+    }
+
+    // restores the map from the checkpoint at path (if present) and the records of log, then attaches log. Returns
+    // false if the checkpoint exists but cannot be loaded
+    bool recover(const std::string &path, WriteAheadLog<K, V> &log) {
+        if (::access(path.c_str(), F_OK) == 0 && !load(path)) {
+            return false;
+        }
+        log.replay(*this);
+        setWriteAheadLog(&log);
+        return true;
+    }
+
+    // replaces the content of the map with a file written by save(). The file is memory-mapped and the table is
+    // presized and built while the map is locked exclusively. If key and value have fixed-size encodings, the records
+    // are split among threadCount workers, which decode and hash every record once and link it under its row's lock
+    // like resize() does. The keys of a file written by save() are unique, so the order of linking does not matter.
+    // Otherwise the records are read by the calling thread without row locking. Returns false and
+    // leaves the map unchanged if the file cannot be read, its header does not match the key and value types or claims
+    // more entries than the file can hold. Returns false and leaves the map empty if a record turns out to be corrupt
+    bool load(const std::string &path, const int threadCount = constants::RESIZE_THREAD_COUNT) {
+        const MappedFile file(path);
+        if (!file.isOpen() || file.size() < sizeof(SnapshotFileHeader)) {
+            return false;
+        }
+
+        SnapshotFileHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        const char *entries = file.data() + sizeof(header);
+        const char *end = file.data() + file.size();
+        const uint64_t recordSize = header.keySize + header.valueSize;
+        const bool fixedSize = header.keySize > 0 && header.valueSize > 0;
+
+        // every encoding occupies at least one byte, thus a corrupt entry count is caught before sizing the table
+        const uint64_t minRecordSize = std::max<uint64_t>(header.keySize, 1) + std::max<uint64_t>(header.valueSize, 1);
+        const uint64_t available = end - entries;
+        if (header.magic != SnapshotFileHeader::MAGIC || header.version != SnapshotFileHeader::VERSION
+                || header.keySize != Serializer<K>::FIXED_SIZE || header.valueSize != Serializer<V>::FIXED_SIZE
+                || header.entryCount > available / minRecordSize
+                || (fixedSize && available != header.entryCount * recordSize)) {
+            return false;
+        }
+
+        const std::lock_guard<std::shared_timed_mutex> exclusiveMapLock(this->mMapMutex);
+        completeSnapshots();
+        purge();
+        mTableRowCount = rowCountFor(header.entryCount);
+        init();
+
+        if (fixedSize) {
+            const int workerCount = std::max(1, threadCount);
+
+            // one single-row partition per worker, the partition index serves as worker index
+            runPartitioned(workerCount, workerCount, [&](const int worker, const int) {
+                const uint64_t firstRecord = header.entryCount * worker / workerCount;
+                const uint64_t lastRecord = header.entryCount * (worker + 1) / workerCount;
+                int insertedCount = 0;
+                for (uint64_t i = firstRecord; i < lastRecord; i++) {
+                    const char *cursor = entries + i * recordSize;
+                    K key = K();
+                    V value = V();
+                    Serializer<K>::read(cursor, end, key);
+                    Serializer<V>::read(cursor, end, value);
+                    const size_t index = mHashFunc(key) % mTableRowCount;
+
+                    // rows are shared between the workers
+                    std::lock_guard<std::shared_timed_mutex> lock(*this->mMutexList[index]);
+                    if (this->insertIntoRow(index, key, value)) {
+                        insertedCount++;
+                    }
+                }
+                mSize += insertedCount;
+            });
+            return true;
+        }
+
+        const char *cursor = entries;
+        for (uint64_t i = 0; i < header.entryCount; i++) {
+            K key = K();
+            V value = V();
+            if (!Serializer<K>::read(cursor, end, key) || !Serializer<V>::read(cursor, end, value)) {
+                purge();
+                init();
+                return false;
+            }
+            if (insertIntoRow(mHashFunc(key) % mTableRowCount, key, value)) {
+                mSize++;
+            }
+        }
+        return true;
+    }
+
+    // calls fn(key, value) for every entry in the map. Only the row currently visited is locked (shared), writers on other
+    // rows are not blocked, thus the walk is weakly consistent like the iterator. fn must not modify the map
+    template<typename Fn>
+    void for_each(Fn fn) {
+        std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
+        for (int i = 0; i < mTableRowCount; i++) {
+            forEachInRow(i, fn);
+        }
+    }
+
+    // parallel version of for_each(), the rows are split into chunks which are handed out dynamically to threadCount
+    // workers (0 uses all hardware threads). Each chunk only takes its rows' shared locks, fn has to be thread-safe
+    template<typename Fn>
+    void parallel_for_each(Fn fn, const int threadCount = 0) {
+        std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
+        runChunked(threadCount, [&](const int, const int firstRow, const int lastRow) {
+            for (int i = firstRow; i < lastRow; i++) {
+                this->forEachInRow(i, fn);
+            }
+        });
+    }
+
+    // maps every entry with mapFn(key, value) and combines the results with reduceFn(T, T) in parallel, see
+    // parallel_for_each(). init has to be the identity of reduceFn, because every worker starts its partial result
+    // with it. reduceFn has to be associative and commutative, since the order of the entries is not defined
+    template<typename T, typename MapFn, typename ReduceFn>
+    T parallel_reduce(MapFn mapFn, ReduceFn reduceFn, const T &init, int threadCount = 0) {
+        threadCount = effectiveThreadCount(threadCount);
+        std::vector<T> partialResults(threadCount, init);
+        {
+            std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
+            runChunked(threadCount, [&](const int worker, const int firstRow, const int lastRow) {
+                T &partial = partialResults[worker];
+                auto accumulate = [&](const K &key, const V &value) {
+                    partial = reduceFn(partial, mapFn(key, value));
+                };
+                for (int i = firstRow; i < lastRow; i++) {
+                    this->forEachInRow(i, accumulate);
+                }
+            });
+        }
+
+        T result = init;
+        for (const auto &partial : partialResults) {
+            result = reduceFn(result, partial);
+        }
+        return result;
+    }
+
+    Iterator begin() {
+        return Iterator(this);
+    }
+
+    Iterator end() {
+        return Iterator();
+    }
+
+    // grows the table so that it can hold count entries without exceeding the maximum load factor, never shrinks it
+    void reserve(const int count, const int threadCount = constants::RESIZE_THREAD_COUNT) {
+        const int rowCount = rowCountFor(std::max(count, 0));
+        {
+            std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
+            if (rowCount <= mTableRowCount) {
+                return;
+            }
+        }
+        resize(rowCount, threadCount);
+    }
+
+    // bounds the number of entries (0 removes the bound). A bounded map evicts entries with a CLOCK approximation of LRU:
+    // get() sets a reference bit in the entry, a clock hand sweeping over the rows clears these bits and evicts the
+    // first entry without one. There is no global LRU list and the hand only locks the row it passes. Lowering the
+    // capacity evicts the excess entries immediately.
+    // With admissionFilter the map additionally applies TinyLFU admission: get() and put() record the keys' access
+    // frequencies in a CountMinSketch, and a new key only replaces the clock hand's victim if it is estimated to be used
+    // more often. Scans of keys that are never used again thus cannot flush the frequently used entries. Recency within
+    // the admitted entries is left to the CLOCK eviction, there is no separate admission window
+    void setCapacity(const int capacity, const bool admissionFilter = false) {
+        MapLog<K, V> *log;
+        uint64_t lsn = 0;
+        {
+            const std::lock_guard<std::shared_timed_mutex> exclusiveMapLock(this->mMapMutex);
+            mCapacity = capacity;
+            mSketch.reset(capacity > 0 && admissionFilter ? new CountMinSketch(capacity) : NULL);
+
+            uint64_t evictionLsn;
+            while (mCapacity > 0 && mSize > mCapacity && evictOne(-1, evictionLsn)) {
+                lsn = std::max(lsn, evictionLsn);
+            }
+            log = mLog;
+        }
+        syncLog(log, lsn);
+    }
+
+    int capacity() {
+        return mCapacity;
+    }
+
+    // sets the function reporting the heap memory owned by a key and a value beyond the node itself, e.g.
+    // key.capacity() + value.capacity() for strings. It is called on every insert, update and removal and has to be
+    // cheap and thread-safe. Walks all entries to account for the present ones, an empty function removes the sizer
+    void setPayloadSizer(const std::function<size_t(const K &, const V &)> &sizer) {
+        const std::lock_guard<std::shared_timed_mutex> exclusiveMapLock(this->mMapMutex);
+        mPayloadSizer = sizer;
+        mPayloadBytes = 0;
+        for (int i = 0; i < mTableRowCount; i++) {
+            for (auto entry = mTable[i]; entry != NULL; entry = entry->getNext()) {
+                mPayloadBytes += payloadSize(entry->getKey(), entry->getValue());
+            }
+        }
+    }
+
+    MemoryUsage memory_usage() {
         std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
+        return memoryUsageInternal();
+    }
+
+    // returns the contention and latency statistics, see HashMapStats.hpp. The counters are read without stopping the
+    // map, the chain lengths are collected row by row like for_each()
+    HashMapStats stats() {
+        std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
+        HashMapStats stats;
+#ifdef HASHMAP_STATS
+        mStats.copyTo(stats);
+#endif
+        for (int i = 0; i < mTableRowCount; i++) {
+            std::shared_lock < std::shared_timed_mutex > sharedLock(*this->mMutexList[i]);
+            size_t length = 0;
+            for (auto entry = mTable[i]; entry != NULL; entry = entry->getNext()) {
+                length++;
+            }
+            if (length >= stats.chainLengths.size()) {
+                stats.chainLengths.resize(length + 1);
+            }
+            stats.chainLengths[length]++;
+        }
+        return stats;
+    }
+
+    // limits memory_usage().total() to bytes (0 removes the limit). put() of an entry that does not fit returns false,
+    // or with evict first evicts entries like a bounded map (see setCapacity()) until it fits. The check happens before
+    // the entry is written, thus concurrent writers may exceed the budget transiently by one entry each. Lowering the
+    // budget with evict evicts the excess entries immediately
+    void setMemoryBudget(const size_t bytes, const bool evict = false) {
+        MapLog<K, V> *log;
+        uint64_t lsn = 0;
+        {
+            const std::lock_guard<std::shared_timed_mutex> exclusiveMapLock(this->mMapMutex);
+            mMemoryBudget = bytes;
+            mBudgetEvicts = evict;
+
+            uint64_t evictionLsn;
+            while (mBudgetEvicts && mMemoryBudget > 0 && memoryUsageInternal().total() > mMemoryBudget
+                    && evictOne(-1, evictionLsn)) {
+                lsn = std::max(lsn, evictionLsn);
+            }
+            log = mLog;
+        }
+        syncLog(log, lsn);
+    }
+
+    // reclaims the expired entries of the next rowBudget rows, continuing where the previous call stopped, and returns
+    // their number. Rows without expired entries are only locked shared and at most one row is locked at a time, thus
+    // calling this periodically (see ExpirySweeper) reclaims expired entries without blocking the map
+    int expire(const int rowBudget) {
+        MapLog<K, V> *log;
+        uint64_t lsn = 0;
+        int expiredCount = 0;
+        {
+            std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
+            log = mLog;
+            const auto now = std::chrono::steady_clock::now();
+            for (int visited = 0; visited < rowBudget && visited < mTableRowCount; visited++) {
+                const int index = mExpiryHand++ % mTableRowCount;
+                if (rowHasExpired(index, now)) {
+                    expiredCount += expireRow(index, now, lsn);
+                }
+            }
+        }
+        syncLog(log, lsn);
+        return expiredCount;
+    }
+
+private:
+    friend class HashMapSnapshot<K, V, F, E, A> ;
+    template<typename, typename, typename> friend class CounterHashMap;
+
+    typedef std::shared_ptr<SnapshotState<K, V, F, E, A> > SnapshotStatePtr;
+
+    typedef typename std::allocator_traits<A>::template rebind_alloc<HashNode<K, V> > NodeAllocator;
+    typedef std::allocator_traits<NodeAllocator> NodeAllocatorTraits;
+
+    // load of a missing key in progress, see get_or_load(). Waiting callers block on mCompleted until mDone is set
+    struct PendingLoad {
+        std::mutex mMutex;
+        std::condition_variable mCompleted;
+        bool mDone = false;
+        bool mFound = false;
+        V mValue = V();
+    };
+
+    // registry of the loads in progress for the keys of one stripe
+    struct PendingStripe {
+        PendingStripe(const F &hashFunc, const E &keyEqual) :
+                mLoads(0, hashFunc, keyEqual) {
+        }
+
+        std::mutex mMutex;
+        std::unordered_map<K, std::shared_ptr<PendingLoad>, F, E> mLoads;
+    };
+
+    static std::vector<std::unique_ptr<PendingStripe> > newPendingStripes(const F &hashFunc, const E &keyEqual) {
+        std::vector<std::unique_ptr<PendingStripe> > stripes;
+        for (int i = 0; i < constants::PENDING_LOAD_STRIPES; i++) {
+            stripes.emplace_back(new PendingStripe(hashFunc, keyEqual));
+        }
+        return stripes;
+    }
+
+    // the stripe is chosen by the hash instead of the row, so it does not change when the table is resized
+    PendingStripe &pendingStripeOf(const K &key) {
+        return *mPendingStripes[mHashFunc(key) % constants::PENDING_LOAD_STRIPES];
+    }
+
+    // unregisters the pending load of key and hands its result to the waiting callers, see get_or_load()
+    void completeLoad(const K &key, PendingLoad &pending, const bool found, const V &value) {
+        {
+            PendingStripe &stripe = pendingStripeOf(key);
+            std::lock_guard<std::mutex> pendingLock(stripe.mMutex);
+            stripe.mLoads.erase(key);
+        }
+        {
+            std::lock_guard<std::mutex> lock(pending.mMutex);
+            pending.mDone = true;
+            pending.mFound = found;
+            if (found) {
+                pending.mValue = value;
+            }
+        }
+        pending.mCompleted.notify_all();
+    }
+
+    // lock the map or a row on the paths of get(), contains(), put() and remove(), recording the wait times and row
+    // lock acquisitions if the map is compiled with HASHMAP_STATS
+    std::shared_lock<std::shared_timed_mutex> lockMapShared() {
+#ifdef HASHMAP_STATS
+        const auto start = std::chrono::steady_clock::now();
+        std::shared_lock < std::shared_timed_mutex > lock(this->mMapMutex);
+        mStats.mapLockAcquired(start);
+        return lock;
+#else
+        return std::shared_lock<std::shared_timed_mutex>(this->mMapMutex);
+#endif
+    }
+
+    std::shared_lock<std::shared_timed_mutex> lockRowShared(const size_t index) {
+#ifdef HASHMAP_STATS
+        const auto start = std::chrono::steady_clock::now();
+        std::shared_lock < std::shared_timed_mutex > lock(*this->mMutexList[index]);
+        mStats.rowLockAcquired(index, start);
+        return lock;
+#else
+        return std::shared_lock<std::shared_timed_mutex>(*this->mMutexList[index]);
+#endif
+    }
+
+    std::unique_lock<std::shared_timed_mutex> lockRowExclusive(const size_t index) {
+#ifdef HASHMAP_STATS
+        const auto start = std::chrono::steady_clock::now();
+        std::unique_lock<std::shared_timed_mutex> lock(*this->mMutexList[index]);
+        mStats.rowLockAcquired(index, start);
+        return lock;
+#else
+        return std::unique_lock<std::shared_timed_mutex>(*this->mMutexList[index]);
+#endif
+    }
+
+    template<typename Q>
+    bool getByKey(const Q &key, V &value) {
+        bool expired = false;
+        if (getInternal(key, value, expired)) {
+            return true;
+        }
+        // only a miss on an expired entry takes the row lock exclusively, plain misses stay read-only
+        if (expired) {
+            reclaimExpired(key);
+        }
+        return false;
+    }
+
+    template<typename Q>
+    bool containsByKey(const Q &key) {
+        // acquire read lock for map instance
+        const auto sharedMapLock = lockMapShared();
+        return containsInternal(key);
+    }
+
+    template<typename Q>
+    bool removeByKey(const Q &key) {
+        MapLog<K, V> *log;
+        uint64_t lsn;
+        {
+            // acquire read lock for map instance
+            const auto sharedMapLock = lockMapShared();
+            log = mLog;
+            lsn = this->removeInternal(key);
+        }
+        return syncLog(log, lsn);
+    }
+
+    // looks up the key, see get(). expired is set if the key is present but its entry has expired. With recordAccess
+    // the lookup is recorded as a read by the admission filter
+    template<typename Q>
+    bool getInternal(const Q &key, V &value, bool &expired, const bool recordAccess = true) {
+        // acquire read lock for map instance
+        const auto sharedMapLock = lockMapShared();
 
         const auto hashValue = mHashFunc(key);
         const auto index = hashValue % mTableRowCount;
 
-        // retrieve mutex for hashmap row and lock
-        std::shared_timed_mutex * mutex = this->mMutexList[index];
-
         // acquire shared lock for row
-        std::shared_lock < std::shared_timed_mutex > sharedLock(*mutex);
+        const auto sharedLock = lockRowShared(index);
+
+        if (mSketch && recordAccess) {
+            // misses count as well, a key missed often enough is admitted once it is put
+            mSketch->recordRead(hashValue);
+        }
 
         auto entry = mTable[hashValue % mTableRowCount];
 
         while (entry != NULL) {
-            if (entry->getKey() == key) {
+            if (mKeyEqual(entry->getKey(), key)) {
+                if (entry->isExpired()) {
+                    expired = true;
+                    break;
+                }
                 value = entry->getValue();
+                if (mCapacity > 0 || mBudgetEvicts) {
+                    entry->markReferenced();
+                }
+#ifdef HASHMAP_STATS
+                mStats.get(true);
+#endif
                 return true;
             }
             entry = entry->getNext();
         }
+#ifdef HASHMAP_STATS
+        mStats.get(false);
+#endif
         return false;
     }
 
-    // external visible function, acquires map global lock before calling the internal put implementation that does the job
-    void put(const K &key, const V &value) {
-        // acquire read lock for map instance, only necessary if an exclusive lock has not already been acquired (e.g. by resize())
-        // reentrant locks are not supported, thus threads are in danger of producing deadlocks themselves
-        std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
-        this->putInternal(key, value);
+    // calls fn with the value of key under the shared row lock, returns false if key is absent or expired. fn may only
+    // modify the value through atomic operations, e.g. AtomicCounter::add(). Such a change bypasses the copy-on-write of
+    // snapshots and the write-ahead log, thus it is reserved to CounterHashMap, which exposes neither
+    template<typename Fn>
+    bool updateShared(const K &key, Fn fn) {
+        const auto sharedMapLock = lockMapShared();
+        const size_t index = mHashFunc(key) % mTableRowCount;
+        const auto sharedLock = lockRowShared(index);
+        for (auto entry = mTable[index]; entry != NULL; entry = entry->getNext()) {
+            if (mKeyEqual(entry->getKey(), key)) {
+                if (entry->isExpired()) {
+                    return false;
+                }
+                fn(entry->getValue());
+                return true;
+            }
+        }
+        return false;
     }
 
-    void remove(const K &key) {
-        // acquire read lock for map instance
-        std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
+    // acquires map global lock before calling the internal put implementation that does the job, see put(). Without
+    // recordAccess the put is not recorded by the admission filter, because the caller has recorded the key already
+    bool putWithExpiry(const K &key, const V &value, const std::chrono::steady_clock::time_point expiry,
+            const bool onlyIfAbsent = false, const bool recordAccess = true) {
+        // acquire read lock for map instance, only necessary if an exclusive lock has not already been acquired (e.g. by resize())
+        // reentrant locks are not supported, thus threads are in danger of producing deadlocks themselves
+        MapLog<K, V> *log;
+        uint64_t lsn;
+        bool present = false;
+        {
+            const auto sharedMapLock = lockMapShared();
+            log = mLog;
 
-        const auto hashValue = mHashFunc(key);
-        HashNode<K, V> *prev = NULL;
-        const size_t index = hashValue % mTableRowCount;
+            // nothing to evict for, checked again under the row lock by putInternal()
+            if (onlyIfAbsent && containsInternal(key)) {
+                return false;
+            }
 
-        // retrieve mutex for hashmap row and lock
-        std::shared_timed_mutex * mutex = this->mMutexList[index];
+            // a bounded map that is full makes room before inserting a new key, concurrent writers may exceed the
+            // capacity transiently by one entry each
+            int frequency = -1;
+            if (mSketch) {
+                const size_t hashValue = mHashFunc(key);
+                if (recordAccess) {
+                    mSketch->increment(hashValue);
+                }
+                frequency = mSketch->estimate(hashValue);
+            }
+            if (mCapacity > 0 && mSize >= mCapacity && !containsInternal(key)) {
+                uint64_t evictionLsn;
+                if (!evictOne(frequency, evictionLsn) && mSketch) {
+                    // rejected, no node is allocated for a key that is not likely to be used again
+                    return false;
+                }
+            }
+            if (mMemoryBudget > 0 && !fitMemoryBudget(key, value)) {
+                return false;
+            }
+            lsn = this->putInternal(key, value, expiry, onlyIfAbsent, present);
+        }
 
-        // acquire exclusive row lock
-        std::lock_guard<std::shared_timed_mutex> lock(*mutex);
-        auto entry = mTable[index];
+        // wait for the group commit after releasing the locks, so writers queued behind this one can join the batch
+        return syncLog(log, lsn) && !present;
+    }
 
-        while (entry != NULL && entry->getKey() != key) {
-            prev = entry;
-            entry = entry->getNext();
+    // makes room for putting key and value within the memory budget, evicting entries if the budget allows it. Returns
+    // false if the entry does not fit. The caller has to hold the map lock but no row lock
+    bool fitMemoryBudget(const K &key, const V &value) {
+        const size_t required = sizeof(HashNode<K, V>) + payloadSize(key, value);
+        uint64_t evictionLsn;
+        // an update replaces the present entry, which may itself be evicted while making room
+        while (memoryUsageInternal().total() + required > mMemoryBudget + footprintOf(key)) {
+            if (!mBudgetEvicts || !evictOne(-1, evictionLsn)) {
+                return false;
+            }
         }
+        return true;
+    }
 
-        if (entry == NULL) {
-            // key could not be found
-            return;
-        } else {
-            if (prev == NULL) {
-                // remove first row from the list
-                mTable[index] = entry->getNext();
-            } else {
-                prev->setNext(entry->getNext());
+    // memory occupied by the entry of key, 0 if the key is not present. The caller has to hold the map lock
+    size_t footprintOf(const K &key) {
+        const size_t index = mHashFunc(key) % mTableRowCount;
+
+        // acquire shared lock for row
+        std::shared_lock < std::shared_timed_mutex > sharedLock(*this->mMutexList[index]);
+
+        for (auto entry = mTable[index]; entry != NULL; entry = entry->getNext()) {
+            if (mKeyEqual(entry->getKey(), key)) {
+                return sizeof(HashNode<K, V>) + payloadSize(entry->getKey(), entry->getValue());
             }
-            mSize--;
-            delete entry;
         }
+        return 0;
     }
 
-    void clear() {
-        purge();
-        init();
+    // see memory_usage(), the caller has to hold the map lock
+    MemoryUsage memoryUsageInternal() const {
+        const size_t rowSize = sizeof(HashNode<K, V> *) + sizeof(std::shared_timed_mutex *)
+                + sizeof(std::shared_timed_mutex) + sizeof(int);
+
+        MemoryUsage usage;
+        usage.structure = sizeof(*this) + mTableRowCount * rowSize + mSize * sizeof(HashNode<K, V>);
+        usage.payload = mPayloadBytes;
+        return usage;
     }
 
-    int size() {
-        return mSize;
+    // heap memory owned by key and value as reported by the payload sizer
+    size_t payloadSize(const K &key, const V &value) const {
+        return mPayloadSizer ? mPayloadSizer(key, value) : 0;
     }
 
-    void resize(const int newTableRowCount) {
+    // deletes a node unlinked from the table and updates the payload accounting
+    void destroyNode(HashNode<K, V> *entry) {
+        if (mPayloadSizer) {
+            mPayloadBytes -= payloadSize(entry->getKey(), entry->getValue());
+        }
+        deleteNode(entry);
+    }
 
-        // acquire write lock for complete map, no other operations are allowed while purging is running
-        const std::lock_guard<std::shared_timed_mutex> exclusiveMapLock(this->mMapMutex);
-        const int numberOfEntries = mSize;
+    // all nodes are created and deleted by these two functions through the node allocator
+    HashNode<K, V> *newNode(const K &key, const V &value) {
+        const auto node = NodeAllocatorTraits::allocate(mNodeAllocator, 1);
+        try {
+            NodeAllocatorTraits::construct(mNodeAllocator, node, key, value);
+        } catch (...) {
+            NodeAllocatorTraits::deallocate(mNodeAllocator, node, 1);
+            throw;
+        }
+        return node;
+    }
 
-        const auto cache = new HashNode<K, V>*[numberOfEntries];
-        int entryCount = 0;
+    void deleteNode(HashNode<K, V> *node) {
+        NodeAllocatorTraits::destroy(mNodeAllocator, node);
+        NodeAllocatorTraits::deallocate(mNodeAllocator, node, 1);
+    }
 
-        // cache all current entries in the table
-        for (int i = 0; i < mTableRowCount; i++) {
-            const HashNode<K, V>* entry = mTable[i];
-            while (entry != NULL) {
-                const auto key = entry->getKey();
-                const auto value = entry->getValue();
+    // removes the key if its entry has expired, called by get() after the entry has been found expired under the
+    // shared row lock
+    template<typename Q>
+    void reclaimExpired(const Q &key) {
+        MapLog<K, V> *log;
+        uint64_t lsn;
+        {
+            std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
+            log = mLog;
+            lsn = this->removeInternal(key, true);
+        }
+        syncLog(log, lsn);
+    }
 
-                cache[entryCount] = new HashNode<K, V>(key, value);
-                entry = entry->getNext();
-                entryCount++;
+    // returns true if the row holds an entry that has expired at now, the caller has to hold the map lock
+    bool rowHasExpired(const int index, const std::chrono::steady_clock::time_point now) {
+        std::shared_lock < std::shared_timed_mutex > sharedLock(*this->mMutexList[index]);
+        for (auto entry = mTable[index]; entry != NULL; entry = entry->getNext()) {
+            if (entry->isExpired(now)) {
+                return true;
             }
         }
+        return false;
+    }
 
-        // purge old table
-        purge();
-        this->mTableRowCount = newTableRowCount;
+    // unlinks all entries of the row that have expired at now and returns their number, lsn is raised to the sequence
+    // number of the last logged removal. The caller has to hold the map lock but no row lock
+    int expireRow(const int index, const std::chrono::steady_clock::time_point now, uint64_t &lsn) {
+        // acquire exclusive row lock
+        std::lock_guard<std::shared_timed_mutex> lock(*this->mMutexList[index]);
+        prepareRowForWrite(index);
 
-        // create and initialize table data for new tableRowCount
-        init();
-        for (int i = 0; i < numberOfEntries; i++) {
-            const auto cur = cache[i];
-            putInternal(cur->getKey(), cur->getValue());
+        int expiredCount = 0;
+        HashNode<K, V> *prev = NULL;
+        auto entry = mTable[index];
+        while (entry != NULL) {
+            const auto next = entry->getNext();
+            if (!entry->isExpired(now)) {
+                prev = entry;
+            } else {
+                if (prev == NULL) {
+                    mTable[index] = next;
+                } else {
+                    prev->setNext(next);
+                }
+                mSize--;
+                if (mLog != NULL) {
+                    lsn = mLog->appendRemove(entry->getKey());
+                }
+                destroyNode(entry);
+                expiredCount++;
+            }
+            entry = next;
         }
+        return expiredCount;
+    }
 
-        // delete all cache data
-        for (int i = 0; i < numberOfEntries; i++) {
-            delete cache[i];
+    // returns true if the key is present and not expired, the caller has to hold the map lock
+    template<typename Q>
+    bool containsInternal(const Q &key) {
+        const size_t index = mHashFunc(key) % mTableRowCount;
+
+        // acquire shared lock for row
+        const auto sharedLock = lockRowShared(index);
+
+        for (auto entry = mTable[index]; entry != NULL; entry = entry->getNext()) {
+            if (mKeyEqual(entry->getKey(), key)) {
+                return !entry->isExpired();
+            }
         }
-        delete[] cache;
+        return false;
     }
 
-private:
+    // advances the clock hand row by row and evicts the first entry whose reference bit is clear or which has expired,
+    // clearing the bits of the entries it passes. Two sweeps over the table always find a victim unless the map is
+    // empty. If candidateFrequency is not negative, a victim that has not expired is only evicted if the admission
+    // filter estimates it to be used less often. The caller has to hold the map lock but no row lock. Returns true if an entry has been evicted, lsn is set
+    // to the sequence number of the logged eviction or 0 if nothing was logged
+    bool evictOne(const int candidateFrequency, uint64_t &lsn) {
+        lsn = 0;
+        for (int visited = 0; visited < 2 * mTableRowCount; visited++) {
+            const int index = mClockHand++ % mTableRowCount;
 
-    void putInternal(const K &key, const V &value) {
-        const size_t hashValue = mHashFunc(key);
+            // acquire exclusive row lock
+            std::lock_guard<std::shared_timed_mutex> lock(*this->mMutexList[index]);
+            if (mTable[index] == NULL) {
+                continue;
+            }
 
-        HashNode<K, V> *prev = NULL;
+            // clearing reference bits is not a write snapshots could see, the row is only copied for an unlink
+            int position = 0;
+            for (auto entry = mTable[index]; entry != NULL; position++, entry = entry->getNext()) {
+                const bool expired = entry->isExpired();
+                if (!expired && entry->clearReferenced()) {
+                    continue;
+                }
+                if (!expired && candidateFrequency >= 0
+                        && candidateFrequency <= mSketch->estimate(mHashFunc(entry->getKey()))) {
+                    return false;
+                }
+
+                // a copied row holds the victim at the same position
+                prepareRowForWrite(index);
+                HashNode<K, V> *prev = NULL;
+                entry = mTable[index];
+                for (; position > 0; position--) {
+                    prev = entry;
+                    entry = entry->getNext();
+                }
+                if (prev == NULL) {
+                    mTable[index] = entry->getNext();
+                } else {
+                    prev->setNext(entry->getNext());
+                }
+                mSize--;
+                if (mLog != NULL) {
+                    lsn = mLog->appendRemove(entry->getKey());
+                }
+                destroyNode(entry);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // calls fn(key, value) for every entry in the given row while holding the row's shared lock
+    template<typename Fn>
+    void forEachInRow(const int index, Fn &fn) {
+        std::shared_lock < std::shared_timed_mutex > sharedLock(*this->mMutexList[index]);
+        for (auto entry = mTable[index]; entry != NULL; entry = entry->getNext()) {
+            if (!entry->isExpired()) {
+                fn(entry->getKey(), entry->getValue());
+            }
+        }
+    }
+
+    // row count needed to hold count entries without exceeding the maximum load factor, bounded by the largest int
+    static int rowCountFor(const uint64_t count) {
+        const uint64_t rowCount = count / constants::MAX_LOAD_FACTOR + (count % constants::MAX_LOAD_FACTOR != 0);
+        return static_cast<int>(std::min<uint64_t>(std::numeric_limits<int>::max(),
+                std::max<uint64_t>(constants::TABLE_SIZE, rowCount)));
+    }
+
+    // removes the key (with expiredOnly only if its entry has expired) and returns the sequence number of the logged
+    // removal, 0 if nothing has been logged
+    template<typename Q>
+    uint64_t removeInternal(const Q &key, const bool expiredOnly = false) {
+        const auto hashValue = mHashFunc(key);
+        HashNode<K, V> *prev;
         const size_t index = hashValue % mTableRowCount;
 
-        // retrieve mutex for hashmap row and lock
-        std::shared_timed_mutex * mutex = this->mMutexList[index];
+        // acquire exclusive row lock
+        const auto lock = lockRowExclusive(index);
+        auto entry = findInRow(index, key, prev);
+
+        if (entry == NULL || (expiredOnly && !entry->isExpired())) {
+            // key could not be found
+            return 0;
+        } else {
+            // the row is only copied for the snapshots if something is removed, the nodes found so far belong to the
+            // snapshots afterwards
+            if (mRowEpochs[index] != mSnapshotEpoch) {
+                prepareRowForWrite(index);
+                entry = findInRow(index, key, prev);
+            }
+
+            if (prev == NULL) {
+                // remove first row from the list
+                mTable[index] = entry->getNext();
+            } else {
+                prev->setNext(entry->getNext());
+            }
+            mSize--;
+            // logs the stored key, key may be of another type
+            const uint64_t lsn = mLog != NULL ? mLog->appendRemove(entry->getKey()) : 0;
+            destroyNode(entry);
+            return lsn;
+        }
+    }
+
+    // returns the node of key in the given row and sets prev to its predecessor (NULL for the first node), returns NULL
+    // if the key is absent. The caller has to lock the row
+    template<typename Q>
+    HashNode<K, V> *findInRow(const size_t index, const Q &key, HashNode<K, V> *&prev) {
+        prev = NULL;
+        auto entry = mTable[index];
+        while (entry != NULL && !mKeyEqual(entry->getKey(), key)) {
+            prev = entry;
+            entry = entry->getNext();
+        }
+        return entry;
+    }
+
+    // inserts or updates the entry and returns the sequence number of the logged put, 0 if nothing has been logged.
+    // With onlyIfAbsent a present entry is left unchanged and present is set
+    uint64_t putInternal(const K &key, const V &value, const std::chrono::steady_clock::time_point expiry,
+            const bool onlyIfAbsent, bool &present) {
+        const size_t hashValue = mHashFunc(key);
+        const size_t index = hashValue % mTableRowCount;
 
         // acquire exclive lock on shared mutex to prevent modifications on the same row in the map
-        std::lock_guard<std::shared_timed_mutex> lock(*mutex);
+        const auto lock = lockRowExclusive(index);
+        if (onlyIfAbsent) {
+            for (auto entry = mTable[index]; entry != NULL; entry = entry->getNext()) {
+                if (mKeyEqual(entry->getKey(), key)) {
+                    present = !entry->isExpired();
+                    break;
+                }
+            }
+            if (present) {
+                return 0;
+            }
+        }
+        prepareRowForWrite(index);
 
+        if (insertIntoRow(index, key, value, expiry)) {
+            mSize++;
+        }
+        return mLog != NULL ? mLog->appendPut(key, value) : 0;
+    }
+
+    // waits until the record with the given sequence number is durable, if one has been logged. Returns false if the
+    // log has failed
+    static bool syncLog(MapLog<K, V> *log, const uint64_t lsn) {
+        return lsn == 0 || log->sync(lsn);
+    }
+
+    // inserts the key-value pair into the given row or updates value and expiry if the key is already present, returns
+    // true if a new entry has been created. The caller is responsible for locking the row and for updating the size
+    bool insertIntoRow(const size_t index, const K &key, const V &value,
+            const std::chrono::steady_clock::time_point expiry = HashNode<K, V>::NEVER) {
+        HashNode<K, V> *prev = NULL;
         auto entry = mTable[index];
 
-        while (entry != NULL && entry->getKey() != key) {
+        while (entry != NULL && !mKeyEqual(entry->getKey(), key)) {
             prev = entry;
             entry = entry->getNext();
         }
 
         if (entry == NULL) {
-            entry = new HashNode<K, V>(key, value);
+            entry = newNode(key, value);
+            entry->setExpiry(expiry);
+            if (mPayloadSizer) {
+                mPayloadBytes += payloadSize(key, value);
+            }
             if (prev == NULL) {
                 // insert as first bucket
                 mTable[index] = entry;
             } else {
                 prev->setNext(entry);
             }
-
-            mSize++;
+            return true;
         } else {
             // just update the value
+            if (mPayloadSizer) {
+                mPayloadBytes += payloadSize(key, value);
+                mPayloadBytes -= payloadSize(entry->getKey(), entry->getValue());
+            }
             entry->setValue(value);
+            entry->setExpiry(expiry);
+            return false;
         }
     }
 
-    // init is not secured by locks, because the calling methods are guarded
-    void init() {
-        mTable = new HashNode<K, V> *[mTableRowCount]();
-        mSize = 0;
+    // creates a snapshot, the caller has to hold the exclusive map lock
+    HashMapSnapshot<K, V, F, E, A> snapshotLocked() {
+        std::lock_guard<std::mutex> registryLock(mSnapshotMutex);
+
+        // forget snapshots whose handles have all been destroyed
+        mSnapshots.erase(std::remove_if(mSnapshots.begin(), mSnapshots.end(), [](const SnapshotStatePtr &state) {
+            return state.use_count() == 1;
+        }), mSnapshots.end());
+
+        const auto state = std::make_shared<SnapshotState<K, V, F, E, A> >(this, ++mSnapshotEpoch,
+                mTableRowCount, mSize, mHashFunc, mKeyEqual);
+        mSnapshots.push_back(state);
+        return HashMapSnapshot<K, V, F, E, A>(state);
+    }
+
+    // writes view to path, see save()
+    static bool saveSnapshot(const HashMapSnapshot<K, V, F, E, A> &view, const std::string &path) {
+        const std::string temporaryPath = path + ".tmp";
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+
+        SnapshotFileHeader header;
+        header.magic = SnapshotFileHeader::MAGIC;
+        header.version = SnapshotFileHeader::VERSION;
+        header.keySize = Serializer<K>::FIXED_SIZE;
+        header.valueSize = Serializer<V>::FIXED_SIZE;
+        header.entryCount = 0;
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        bool success = out.good();
+        view.for_each([&](const K &key, const V &value) {
+            success = success && Serializer<K>::write(out, key) && Serializer<V>::write(out, value);
+            header.entryCount++;
+        });
+
+        // the snapshot's size includes expired entries which have been skipped, thus the count is written last
+        out.seekp(0);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.close();
+
+        if (!success || out.fail() || !syncFile(temporaryPath)
+                || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // has to be called before modifying a row, with the row locked exclusively (or the map locked exclusively). If a
+    // snapshot has been taken since the row was last copied, the row's chain is handed over to the snapshots sharing it
+    // and the row continues on a copy. mSnapshotEpoch only changes under the exclusive map lock, thus the check is cheap
+    void prepareRowForWrite(const int index) {
+        if (mRowEpochs[index] == mSnapshotEpoch) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> registryLock(mSnapshotMutex);
+        std::shared_ptr<SnapshotChain<K, V, A> > chain;
+        for (const auto &state : mSnapshots) {
+            // snapshots taken before the last copy of this row already own their chain, dropped snapshots are skipped
+            if (state->mEpoch > mRowEpochs[index] && state.use_count() > 1) {
+                if (!chain) {
+                    chain = std::make_shared<SnapshotChain<K, V, A> >(mTable[index], mNodeAllocator);
+                    mTable[index] = cloneChain(mTable[index]);
+                }
+                state->captureRow(index, chain);
+            }
+        }
+        mRowEpochs[index] = mSnapshotEpoch;
+    }
+
+    // hands every row still shared with a snapshot over to the snapshots and marks them complete, so they never read
+    // the table again. Called with the map locked exclusively before the table is rebuilt or destroyed
+    void completeSnapshots() {
+        for (int i = 0; i < mTableRowCount; i++) {
+            prepareRowForWrite(i);
+        }
+
+        std::lock_guard<std::mutex> registryLock(mSnapshotMutex);
+        for (const auto &state : mSnapshots) {
+            state->mComplete.store(true, std::memory_order_release);
+        }
+    }
+
+    // called by the destructor, afterwards the snapshots no longer reference this map
+    void detachSnapshots() {
+        std::vector<SnapshotStatePtr> states;
+        {
+            std::lock_guard<std::mutex> registryLock(mSnapshotMutex);
+            states = mSnapshots;
+        }
+
+        // wait for snapshot readers currently accessing the map
+        std::vector<std::unique_lock<std::shared_timed_mutex> > stateLocks;
+        for (const auto &state : states) {
+            stateLocks.emplace_back(state->mMutex);
+        }
+
+        completeSnapshots();
+        for (const auto &state : states) {
+            state->mMap = NULL;
+        }
+    }
+
+    // calls fn with the first node of the given row as seen by the snapshot, used by HashMapSnapshot
+    template<typename Fn>
+    void withSnapshotRow(const SnapshotState<K, V, F, E, A> &state, const int index, Fn &fn) {
+        std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
+        if (state.mComplete.load(std::memory_order_acquire)) {
+            fn((*state.capturedRow(index))->getHead());
+            return;
+        }
+
+        // as long as the snapshot is incomplete, the table has not been rebuilt and shares its row count
+        std::shared_lock < std::shared_timed_mutex > sharedLock(*this->mMutexList[index]);
+        const auto captured = state.capturedRow(index);
+        fn(captured != NULL ? (*captured)->getHead() : mTable[index]);
+    }
+
+    // returns a copy of the chain starting with head, preserving the order of the nodes and their reference bits
+    HashNode<K, V> *cloneChain(const HashNode<K, V> *head) {
+        HashNode<K, V> *first = NULL;
+        HashNode<K, V> *last = NULL;
+        for (; head != NULL; head = head->getNext()) {
+            const auto copy = newNode(head->getKey(), head->getValue());
+            copy->setExpiry(head->getExpiry());
+            if (head->isReferenced()) {
+                copy->markReferenced();
+            }
+            if (last == NULL) {
+                first = copy;
+            } else {
+                last->setNext(copy);
+            }
+            last = copy;
+        }
+        return first;
+    }
+
+    // returns the epochs for a new table of rowCount rows, new rows are not shared with any snapshot
+    int *newRowEpochs(const int rowCount) const {
+        const auto rowEpochs = new int[rowCount];
+        std::fill(rowEpochs, rowEpochs + rowCount, mSnapshotEpoch);
+        return rowEpochs;
+    }
+
+    // moves all nodes of the rows [firstRow, lastRow) into newTable, called concurrently by the resize workers.
+    // The map is locked exclusively, thus the source rows are only touched by the worker owning them, while the
+    // destination rows are shared between workers and have to be guarded by their row mutexes
+    void rehashRows(const int firstRow, const int lastRow, HashNode<K, V> **newTable,
+            std::shared_timed_mutex **newMutexList, const int newTableRowCount) {
+        for (int i = firstRow; i < lastRow; i++) {
+            auto entry = mTable[i];
+            while (entry != NULL) {
+                const auto next = entry->getNext();
+                const size_t index = mHashFunc(entry->getKey()) % newTableRowCount;
+
+                // insert as first bucket of the destination row, the order within a row is irrelevant
+                {
+                    std::lock_guard<std::shared_timed_mutex> lock(*newMutexList[index]);
+                    entry->setNext(newTable[index]);
+                    newTable[index] = entry;
+                }
+                entry = next;
+            }
+            mTable[i] = NULL;
+        }
+    }
+
+    // splits the rows [0, rowCount) into threadCount contiguous ranges and calls fn(firstRow, lastRow) for each of
+    // them in parallel, the calling thread processes the last range itself
+    template<typename Fn>
+    static void runPartitioned(const int rowCount, int threadCount, Fn fn) {
+        threadCount = std::max(1, std::min(threadCount, rowCount));
+        const int rowsPerThread = rowCount / threadCount;
+        const int remainder = rowCount % threadCount;
+
+        std::vector<std::thread> workers;
+        int firstRow = 0;
+        for (int t = 0; t < threadCount; t++) {
+            // distribute the remainder over the first ranges
+            const int lastRow = firstRow + rowsPerThread + (t < remainder ? 1 : 0);
+            if (t == threadCount - 1) {
+                fn(firstRow, lastRow);
+            } else {
+                workers.emplace_back(fn, firstRow, lastRow);
+            }
+            firstRow = lastRow;
+        }
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    // hands out the rows in chunks of constants::ROWS_PER_CHUNK to threadCount workers and calls
+    // fn(worker, firstRow, lastRow) for every chunk, worker is the index of the worker in [0, threadCount)
+    template<typename Fn>
+    void runChunked(int threadCount, Fn fn) {
+        threadCount = effectiveThreadCount(threadCount);
+        std::atomic<int> nextRow(0);
+
+        // one single-row partition per worker, the partition index serves as worker index
+        runPartitioned(threadCount, threadCount, [&](const int worker, const int) {
+            int firstRow;
+            while ((firstRow = nextRow.fetch_add(constants::ROWS_PER_CHUNK)) < mTableRowCount) {
+                fn(worker, firstRow, std::min(firstRow + constants::ROWS_PER_CHUNK, mTableRowCount));
+            }
+        });
+    }
+
+    // replaces a thread count of 0 by the number of hardware threads
+    static int effectiveThreadCount(const int threadCount) {
+        if (threadCount > 0) {
+            return threadCount;
+        }
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // allocates an empty table and one mutex for every row
+    static void allocateRows(const int rowCount, HashNode<K, V> **&table, std::shared_timed_mutex **&mutexList) {
+        table = new HashNode<K, V> *[rowCount]();
 
         // create a list of mutexes, one for every row in the hashmap
-        mMutexList = new std::shared_timed_mutex *[mTableRowCount]();
+        mutexList = new std::shared_timed_mutex *[rowCount]();
 
         // initialize the mutex list
-        for (int i = 0; i < mTableRowCount; i++) {
-            mMutexList[i] = new std::shared_timed_mutex;
+        for (int i = 0; i < rowCount; i++) {
+            mutexList[i] = new std::shared_timed_mutex;
         }
     }
 
+    // releases the table and its mutexes, the nodes within the table have to be destroyed beforehand
+    static void releaseRows(const int rowCount, HashNode<K, V> **table, std::shared_timed_mutex **mutexList) {
+
+        // destroy all mutexes
+        for (int i = 0; i < rowCount; i++) {
+            delete mutexList[i];
+        }
+        delete[] mutexList;
+
+        // destroy the hash table
+        delete[] table;
+    }
+
+    // init is not secured by locks, because the calling methods are guarded
+    void init() {
+        allocateRows(mTableRowCount, mTable, mMutexList);
+        mRowEpochs = newRowEpochs(mTableRowCount);
+        mSize = 0;
+#ifdef HASHMAP_STATS
+        mStats.resetRows(mTableRowCount);
+#endif
+    }
+
     // purge is not secured by locks, because the calling methods are guarded
     void purge() {
 
@@ -200,21 +1558,15 @@ private:
             while (entry != NULL) {
                 const auto prev = entry;
                 entry = entry->getNext();
-                delete prev;
+                deleteNode(prev);
             }
             mTable[i] = NULL;
         }
 
-        // destroy all mutexes
-        for (int i = 0; i < mTableRowCount; i++) {
-            auto entry = mMutexList[i];
-            delete entry;
-        }
-        delete[] mMutexList;
-
-        // destroy the hash table
-        delete[] mTable;
+        releaseRows(mTableRowCount, mTable, mMutexList);
+        delete[] mRowEpochs;
         mSize = 0;
+        mPayloadBytes = 0;
     }
 
     // multidimensional HashNode array used to hold the elements managed within the map
@@ -223,6 +1575,12 @@ private:
     // hash function used for hashing, default is based on std::hash using its provided specializations
     F mHashFunc;
 
+    // key equality, default is based on operator==
+    E mKeyEqual;
+
+    // allocates the nodes
+    NodeAllocator mNodeAllocator;
+
     // element count, use atomic to guarantee atomic increment and decrement operations
     std::atomic<int> mSize;
 
@@ -234,6 +1592,54 @@ private:
 
     // needed to control map-wide lockings e.g. for purging
     std::shared_timed_mutex mMapMutex;
+
+    // incremented by every snapshot, only modified while holding the exclusive map lock
+    int mSnapshotEpoch = 0;
+
+    // snapshot epoch of every row when it was last copied, a row is shared with the snapshots of later epochs
+    int *mRowEpochs;
+
+    // maximum number of entries, 0 if the map is unbounded. Only modified while holding the exclusive map lock
+    int mCapacity = 0;
+
+    // access frequencies for the admission filter of a bounded map, NULL if the filter is disabled. Only replaced while
+    // holding the exclusive map lock
+    std::unique_ptr<CountMinSketch> mSketch;
+
+    // loads in progress by key, striped so that misses of different keys rarely wait for the same mutex. The
+    // placeholders are kept out of the rows, so readers, iterators, snapshots and the write-ahead log never see an
+    // entry without a value. Lock order is a stripe's mutex before the map and row locks
+    std::vector<std::unique_ptr<PendingStripe> > mPendingStripes = newPendingStripes(mHashFunc, mKeyEqual);
+
+    // reports the payload of an entry for memory_usage(), see setPayloadSizer(). Only replaced while holding the
+    // exclusive map lock
+    std::function<size_t(const K &, const V &)> mPayloadSizer;
+
+    // sum of the payload sizes of all entries
+    std::atomic<size_t> mPayloadBytes { 0 };
+
+    // limit of memory_usage().total(), 0 if the map has no memory budget. Only modified while holding the exclusive
+    // map lock
+    size_t mMemoryBudget = 0;
+    bool mBudgetEvicts = false;
+
+#ifdef HASHMAP_STATS
+    // counters returned by stats(), only compiled in with HASHMAP_STATS
+    HashMapStatsRecorder mStats;
+#endif
+
+    // next row visited by expire(), taken modulo the row count
+    std::atomic<unsigned int> mExpiryHand { 0 };
+
+    // position of the clock hand of the CLOCK eviction, taken modulo the row count
+    std::atomic<unsigned int> mClockHand { 0 };
+
+    // attached write-ahead log or NULL, only modified while holding the exclusive map lock
+    MapLog<K, V> *mLog = NULL;
+
+    // snapshots taken from this map, guarded by mSnapshotMutex
+    std::vector<SnapshotStatePtr> mSnapshots;
+    std::mutex mSnapshotMutex;
 };
 
 #endif /* HASHMAP_HPP_ */
@@ -0,0 +1,182 @@
+#ifndef HASHMAPSNAPSHOT_HPP_
+#define HASHMAPSNAPSHOT_HPP_
+
+#include "HashNode.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+template<typename K, typename V, typename F, typename E, typename A>
+class HashMap;
+
+// chain of nodes which has been detached from a map row on the first write after a snapshot, shared by all snapshots
+// that were taken while the row held this chain. The chain is immutable and destroyed with its last snapshot, its
+// nodes are released with a copy of the map's node allocator
+template<typename K, typename V, typename A>
+class SnapshotChain {
+public:
+    typedef typename std::allocator_traits<A>::template rebind_alloc<HashNode<K, V> > NodeAllocator;
+
+    SnapshotChain(HashNode<K, V> *head, const NodeAllocator &allocator) :
+            mHead(head), mAllocator(allocator) {
+    }
+
+    SnapshotChain(const SnapshotChain &) = delete;
+    SnapshotChain &operator=(const SnapshotChain &) = delete;
+
+    ~SnapshotChain() {
+        while (mHead != NULL) {
+            const auto prev = mHead;
+            mHead = mHead->getNext();
+            std::allocator_traits<NodeAllocator>::destroy(mAllocator, prev);
+            std::allocator_traits<NodeAllocator>::deallocate(mAllocator, prev, 1);
+        }
+    }
+
+    const HashNode<K, V> *getHead() const {
+        return mHead;
+    }
+
+private:
+    HashNode<K, V> *mHead;
+
+    NodeAllocator mAllocator;
+};
+
+// state shared between a map and the snapshot handles taken at one point in time. The rows still shared with the map
+// are read from the live table, all other rows have been captured as a SnapshotChain by the writer that modified them
+template<typename K, typename V, typename F, typename E, typename A>
+class SnapshotState {
+public:
+    SnapshotState(HashMap<K, V, F, E, A> *map, const int epoch, const int rowCount, const int size, const F &hashFunc,
+            const E &keyEqual) :
+            mMap(map), mEpoch(epoch), mRowCount(rowCount), mSize(size), mTime(std::chrono::steady_clock::now()), mHashFunc(
+                    hashFunc), mKeyEqual(keyEqual), mRows(NULL), mComplete(false) {
+    }
+
+    SnapshotState(const SnapshotState &) = delete;
+    SnapshotState &operator=(const SnapshotState &) = delete;
+
+    ~SnapshotState() {
+        delete[] mRows.load();
+    }
+
+private:
+    friend class HashMap<K, V, F, E, A> ;
+    template<typename, typename, typename, typename, typename> friend class HashMapSnapshot;
+
+    // returns the captured chain of the given row or NULL if the row is still shared with the map, the caller has to
+    // hold the row lock of the map (or the map has to be detached)
+    const std::shared_ptr<SnapshotChain<K, V, A> > *capturedRow(const int index) const {
+        const auto rows = mRows.load(std::memory_order_acquire);
+        if (rows == NULL || !rows[index]) {
+            return NULL;
+        }
+        return &rows[index];
+    }
+
+    // called by the map with its snapshot registry locked and the row locked exclusively
+    void captureRow(const int index, const std::shared_ptr<SnapshotChain<K, V, A> > &chain) {
+        auto rows = mRows.load(std::memory_order_relaxed);
+        if (rows == NULL) {
+            // the row array is allocated by the first writer, keeping snapshot() itself O(1)
+            rows = new std::shared_ptr<SnapshotChain<K, V, A> > [mRowCount];
+            mRows.store(rows, std::memory_order_release);
+        }
+        rows[index] = chain;
+    }
+
+    // map the snapshot has been taken from, NULL once the map has been destroyed. Guarded by mMutex
+    HashMap<K, V, F, E, A> *mMap;
+
+    // snapshot epoch of the map when this snapshot was taken
+    const int mEpoch;
+
+    // row count and element count of the map when this snapshot was taken
+    const int mRowCount;
+    const int mSize;
+
+    // entries that had expired when the snapshot was taken are not part of it
+    const std::chrono::steady_clock::time_point mTime;
+
+    const F mHashFunc;
+    const E mKeyEqual;
+
+    // captured chains, one per row, allocated lazily
+    std::atomic<std::shared_ptr<SnapshotChain<K, V, A> > *> mRows;
+
+    // set by the map once all rows have been captured, e.g. before resize() or clear()
+    std::atomic<bool> mComplete;
+
+    // held shared while reading through mMap, exclusively by the map's destructor
+    std::shared_timed_mutex mMutex;
+};
+
+// immutable point-in-time view of a HashMap returned by HashMap::snapshot(). Creating a snapshot is O(1): rows are
+// shared with the map until they are modified, then the writer hands the original chain over to the snapshot and
+// continues on a copy (copy-on-write). Handles are cheap to copy and stay valid after the map has been destroyed
+template<typename K, typename V, typename F, typename E, typename A>
+class HashMapSnapshot {
+public:
+
+    bool get(const K &key, V &value) const {
+        const size_t index = mState->mHashFunc(key) % mState->mRowCount;
+        bool found = false;
+        withRow(index, [&](const HashNode<K, V> *entry) {
+            for (; entry != NULL; entry = entry->getNext()) {
+                if (mState->mKeyEqual(entry->getKey(), key)) {
+                    if (!entry->isExpired(mState->mTime)) {
+                        value = entry->getValue();
+                        found = true;
+                    }
+                    return;
+                }
+            }
+        });
+        return found;
+    }
+
+    // number of entries when the snapshot was taken, including expired entries the map had not reclaimed yet
+    int size() const {
+        return mState->mSize;
+    }
+
+    // calls fn(key, value) for every entry of the snapshot
+    template<typename Fn>
+    void for_each(Fn fn) const {
+        for (int i = 0; i < mState->mRowCount; i++) {
+            withRow(i, [&](const HashNode<K, V> *entry) {
+                for (; entry != NULL; entry = entry->getNext()) {
+                    if (!entry->isExpired(mState->mTime)) {
+                        fn(entry->getKey(), entry->getValue());
+                    }
+                }
+            });
+        }
+    }
+
+private:
+    friend class HashMap<K, V, F, E, A> ;
+
+    explicit HashMapSnapshot(const std::shared_ptr<SnapshotState<K, V, F, E, A> > &state) :
+            mState(state) {
+    }
+
+    // calls fn with the first node of the given row as seen by this snapshot
+    template<typename Fn>
+    void withRow(const int index, Fn fn) const {
+        std::shared_lock < std::shared_timed_mutex > stateLock(mState->mMutex);
+        if (mState->mMap != NULL && !mState->mComplete.load(std::memory_order_acquire)) {
+            mState->mMap->withSnapshotRow(*mState, index, fn);
+        } else {
+            // complete or detached, every row has been captured
+            fn((*mState->capturedRow(index))->getHead());
+        }
+    }
+
+    std::shared_ptr<SnapshotState<K, V, F, E, A> > mState;
+};
+
+#endif /* HASHMAPSNAPSHOT_HPP_ */
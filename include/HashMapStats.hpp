@@ -0,0 +1,192 @@
+#ifndef HASHMAPSTATS_HPP_
+#define HASHMAPSTATS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Contention and latency statistics of a HashMap as returned by HashMap::stats(). The counters are only recorded if
+// HASHMAP_STATS is defined when compiling (e.g. -DHASHMAP_STATS), otherwise the recording code is not compiled in at
+// all, the counters stay 0 and enabled is false. The chain length distribution is computed by stats() itself and is
+// always available.
+//
+// HASHMAP_STATS changes the layout of HashMap, which is a template defined in its header. All translation units of a
+// program that instantiate HashMap with the same template arguments have to agree on it, otherwise they violate the
+// one definition rule and the linker silently picks one of the differing definitions. Define it for the whole program
+// (e.g. in the build flags) rather than before including HashMap.hpp in a single source file. A unit that has to
+// differ, like the statistics test, must instantiate HashMap with template arguments no other unit uses
+
+// histogram of durations with power-of-two buckets: bucket 0 counts durations below 1ns, bucket i > 0 durations in
+// [2^(i-1), 2^i) nanoseconds and the last bucket everything above
+struct LatencyHistogram {
+    static const int BUCKET_COUNT = 40;
+
+    uint64_t buckets[BUCKET_COUNT] = { };
+
+    uint64_t count() const {
+        uint64_t total = 0;
+        for (const auto bucket : buckets) {
+            total += bucket;
+        }
+        return total;
+    }
+
+    // upper bound in nanoseconds of the bucket holding the given quantile in [0, 1], 0 if the histogram is empty
+    uint64_t percentile(const double quantile) const {
+        const uint64_t total = count();
+        if (total == 0) {
+            return 0;
+        }
+        const uint64_t rank = static_cast<uint64_t>(quantile * (total - 1));
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKET_COUNT; i++) {
+            seen += buckets[i];
+            if (seen > rank) {
+                return uint64_t(1) << i;
+            }
+        }
+        return uint64_t(1) << (BUCKET_COUNT - 1);
+    }
+};
+
+struct HashMapStats {
+    // true if the map has been compiled with HASHMAP_STATS
+    bool enabled = false;
+
+    // acquisitions of every row lock by get(), contains(), put() and remove() since the table was last rebuilt
+    // (resize(), clear(), load()), indexed by row
+    std::vector<uint64_t> rowLockAcquisitions;
+
+    // time spent waiting for the map lock (mMapMutex) and the row locks (mMutexList[i]) by these operations and resize()
+    LatencyHistogram mapLockWait;
+    LatencyHistogram rowLockWait;
+
+    // chainLengths[n] is the number of rows holding n entries
+    std::vector<uint64_t> chainLengths;
+
+    uint64_t getHits = 0;
+    uint64_t getMisses = 0;
+
+    // number of resize() calls and their durations, including the wait for the exclusive map lock
+    uint64_t resizeCount = 0;
+    uint64_t resizeNanosecondsTotal = 0;
+    uint64_t resizeNanosecondsLast = 0;
+};
+
+// lock-free recording side of HashMapStats, only instantiated by maps compiled with HASHMAP_STATS. The recording must
+// not add contention of its own: every row counter occupies a cache line of its own, and the counters updated by every
+// operation are sharded by thread, so threads working on different rows do not write to the same cache line
+class HashMapStatsRecorder {
+public:
+    static const int SHARD_COUNT = 16;
+
+    // resets the per-row counters for a new table, the map has to be locked exclusively
+    void resetRows(const int rowCount) {
+        std::vector<RowCounter> rowLockAcquisitions(rowCount);
+        mRowLockAcquisitions.swap(rowLockAcquisitions);
+    }
+
+    // records the acquisition of the map lock started at start
+    void mapLockAcquired(const std::chrono::steady_clock::time_point start) {
+        record(shard().mapLockWait, std::chrono::steady_clock::now() - start);
+    }
+
+    // records the acquisition of the lock of the given row started at start
+    void rowLockAcquired(const int index, const std::chrono::steady_clock::time_point start) {
+        record(shard().rowLockWait, std::chrono::steady_clock::now() - start);
+        mRowLockAcquisitions[index].count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void get(const bool hit) {
+        Shard &current = shard();
+        (hit ? current.getHits : current.getMisses).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void resized(const std::chrono::steady_clock::duration duration) {
+        const uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        mResizeCount.fetch_add(1, std::memory_order_relaxed);
+        mResizeNanosecondsTotal.fetch_add(nanoseconds, std::memory_order_relaxed);
+        mResizeNanosecondsLast.store(nanoseconds, std::memory_order_relaxed);
+    }
+
+    // copies the counters into stats, the map has to be locked (shared) so the row count does not change
+    void copyTo(HashMapStats &stats) const {
+        stats.enabled = true;
+        stats.rowLockAcquisitions.clear();
+        for (const auto &counter : mRowLockAcquisitions) {
+            stats.rowLockAcquisitions.push_back(counter.count.load(std::memory_order_relaxed));
+        }
+        stats.mapLockWait = LatencyHistogram();
+        stats.rowLockWait = LatencyHistogram();
+        stats.getHits = 0;
+        stats.getMisses = 0;
+        for (const auto &current : mShards) {
+            add(current.mapLockWait, stats.mapLockWait);
+            add(current.rowLockWait, stats.rowLockWait);
+            stats.getHits += current.getHits.load(std::memory_order_relaxed);
+            stats.getMisses += current.getMisses.load(std::memory_order_relaxed);
+        }
+        stats.resizeCount = mResizeCount.load(std::memory_order_relaxed);
+        stats.resizeNanosecondsTotal = mResizeNanosecondsTotal.load(std::memory_order_relaxed);
+        stats.resizeNanosecondsLast = mResizeNanosecondsLast.load(std::memory_order_relaxed);
+    }
+
+private:
+
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    typedef std::atomic<uint64_t> AtomicHistogram[LatencyHistogram::BUCKET_COUNT];
+
+    // padded instead of aligned, because operator new does not honour over-alignment before C++17. A counter at any
+    // 8 byte aligned address thus shares its cache line with no other counter
+    struct RowCounter {
+        std::atomic<uint64_t> count { 0 };
+        char padding[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>)];
+    };
+    static_assert(sizeof(RowCounter) == CACHE_LINE_SIZE, "row counters have to fill a cache line");
+
+    // counters of the threads mapped to one shard, the padding separates them from the next shard
+    struct Shard {
+        AtomicHistogram mapLockWait = { };
+        AtomicHistogram rowLockWait = { };
+        std::atomic<uint64_t> getHits { 0 };
+        std::atomic<uint64_t> getMisses { 0 };
+        char padding[CACHE_LINE_SIZE];
+    };
+
+    // shard of the calling thread, threads are assigned to the shards round robin on their first recording
+    Shard &shard() {
+        static std::atomic<unsigned int> nextShard(0);
+        static thread_local const unsigned int threadShard = nextShard.fetch_add(1, std::memory_order_relaxed)
+                % SHARD_COUNT;
+        return mShards[threadShard];
+    }
+
+    static void record(AtomicHistogram &histogram, const std::chrono::steady_clock::duration duration) {
+        uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        int bucket = 0;
+        while (nanoseconds > 0 && bucket < LatencyHistogram::BUCKET_COUNT - 1) {
+            nanoseconds >>= 1;
+            bucket++;
+        }
+        histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void add(const AtomicHistogram &histogram, LatencyHistogram &target) {
+        for (int i = 0; i < LatencyHistogram::BUCKET_COUNT; i++) {
+            target.buckets[i] += histogram[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    std::vector<RowCounter> mRowLockAcquisitions;
+
+    Shard mShards[SHARD_COUNT];
+
+    std::atomic<uint64_t> mResizeCount { 0 };
+    std::atomic<uint64_t> mResizeNanosecondsTotal { 0 };
+    std::atomic<uint64_t> mResizeNanosecondsLast { 0 };
+};
+
+#endif /* HASHMAPSTATS_HPP_ */
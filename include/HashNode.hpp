@@ -1,19 +1,23 @@
 #ifndef HASHNODE_HPP_
 #define HASHNODE_HPP_
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
 // Hash node class template
 template<typename K, typename V>
 class HashNode {
 public:
 	HashNode(const K &key, const V &value) :
-			key(key), value(value), next(NULL) {
+			key(key), value(value), next(NULL), referenced(false), expiry(NEVER) {
 	}
 
-	K getKey() const {
+	const K &getKey() const {
 		return key;
 	}
 
-	V getValue() const {
+	const V &getValue() const {
 		return value;
 	}
 
@@ -29,6 +33,44 @@ public:
 		HashNode::next = next;
 	}
 
+	std::chrono::steady_clock::time_point getExpiry() const {
+		return expiry;
+	}
+
+	// NEVER removes the expiry
+	void setExpiry(std::chrono::steady_clock::time_point expiry) {
+		HashNode::expiry = expiry;
+	}
+
+	// returns true if the entry has an expiry which has passed. The clock is only read for entries with an expiry
+	bool isExpired() const {
+		return expiry != NEVER && expiry <= std::chrono::steady_clock::now();
+	}
+
+	bool isExpired(std::chrono::steady_clock::time_point now) const {
+		return expiry <= now;
+	}
+
+	static constexpr std::chrono::steady_clock::time_point NEVER = std::chrono::steady_clock::time_point::max();
+
+	// sets the reference bit used for CLOCK eviction, callable while holding only a shared row lock. The bit is
+	// only written if it is not set yet, so hot entries do not bounce their cache line between readers
+	void markReferenced() {
+		if (!referenced.load(std::memory_order_relaxed)) {
+			referenced.store(true, std::memory_order_relaxed);
+		}
+	}
+
+	// returns the reference bit used for CLOCK eviction
+	bool isReferenced() const {
+		return referenced.load(std::memory_order_relaxed);
+	}
+
+	// clears the reference bit and returns its previous value
+	bool clearReferenced() {
+		return referenced.exchange(false, std::memory_order_relaxed);
+	}
+
 private:
 	// key-value pair to hold the entry data for the hashmap
 	K key;
@@ -36,6 +78,16 @@ private:
 
 	// next node with the same map index
 	HashNode *next;
+
+	// set on access if the map is capacity-bounded, cleared by the passing clock hand
+	std::atomic<bool> referenced;
+
+	// point in time the entry expires at, NEVER if it does not expire. Expired entries are invisible to readers and
+	// are reclaimed lazily or by HashMap::expire()
+	std::chrono::steady_clock::time_point expiry;
 };
 
+template<typename K, typename V>
+constexpr std::chrono::steady_clock::time_point HashNode<K, V>::NEVER;
+
 #endif /* HASHNODE_HPP_ */
@@ -0,0 +1,244 @@
+#ifndef OFFSETHASHTABLE_HPP_
+#define OFFSETHASHTABLE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// node of an OffsetHashTable, linked by its offset from the start of the region instead of a pointer, so the table
+// stays valid wherever the region is mapped. Offset 0 (the region header) marks the end of a chain
+template<typename K, typename V>
+struct OffsetHashNode {
+    K key;
+    V value;
+    uint64_t next;
+};
+
+// header at the start of an OffsetHashTable region
+struct OffsetHashTableHeader {
+    // identifies the kind of map owning the region
+    uint32_t magic;
+
+    // has to be incremented on every incompatible change of the layout
+    uint32_t version;
+
+    // sizes of key and value, a region can only be opened with the same types
+    uint32_t keySize;
+    uint32_t valueSize;
+
+    uint64_t rowCount;
+
+    // number of node slots in the region and number of slots handed out so far by the bump allocator
+    uint64_t nodeCapacity;
+    uint64_t nodeCount;
+
+    // offset of the first released node, released nodes are linked by their next offset
+    uint64_t freeList;
+
+    // element count, shared by all writers
+    std::atomic<uint64_t> size;
+
+    // 1 if the region has been closed properly, 0 while it is in use
+    uint32_t clean;
+};
+
+// hash table layout inside a contiguous memory region (a mapped file or a shared memory segment):
+//
+//   OffsetHashTableHeader
+//   rowCount bucket offsets
+//   nodeCapacity OffsetHashNode slots
+//
+// The table does not lock, its owner guards the rows and the allocator and calls attach() whenever the region moves
+template<typename K, typename V, typename F = std::hash<K> >
+class OffsetHashTable {
+public:
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+            "keys and values of an OffsetHashTable are stored in the region and have to be trivially copyable");
+
+    typedef OffsetHashNode<K, V> Node;
+
+    static const uint32_t VERSION = 1;
+
+    // size of a region holding rowCount rows and nodeCapacity nodes
+    static size_t regionSize(const uint64_t rowCount, const uint64_t nodeCapacity) {
+        return nodesOffset(rowCount) + nodeCapacity * sizeof(Node);
+    }
+
+    // number of nodes a region of regionSize bytes can hold
+    static uint64_t nodeCapacityFor(const uint64_t rowCount, const size_t regionSize) {
+        return (regionSize - nodesOffset(rowCount)) / sizeof(Node);
+    }
+
+    // writes an empty table into a region of at least regionSize(rowCount, nodeCapacity) bytes. The region is not
+    // marked clean, see setClean()
+    static void format(char *base, const uint32_t magic, const uint64_t rowCount, const uint64_t nodeCapacity) {
+        const auto header = new (base) OffsetHashTableHeader;
+        header->magic = magic;
+        header->version = VERSION;
+        header->keySize = sizeof(K);
+        header->valueSize = sizeof(V);
+        header->rowCount = rowCount;
+        header->nodeCapacity = nodeCapacity;
+        header->clean = 0;
+        OffsetHashTable table;
+        table.attach(base);
+        table.clear();
+    }
+
+    // checks whether a region of regionSize bytes holds a table created by format() for the same magic and types
+    static bool isValid(const char *base, const size_t regionSize, const uint32_t magic) {
+        if (regionSize < sizeof(OffsetHashTableHeader)) {
+            return false;
+        }
+        const auto header = reinterpret_cast<const OffsetHashTableHeader *>(base);
+        return header->magic == magic && header->version == VERSION && header->keySize == sizeof(K)
+                && header->valueSize == sizeof(V) && header->rowCount > 0
+                && OffsetHashTable::regionSize(header->rowCount, header->nodeCapacity) <= regionSize;
+    }
+
+    OffsetHashTable() :
+            mBase(NULL) {
+    }
+
+    // (re)binds the table to the region starting at base
+    void attach(char *base) {
+        mBase = base;
+    }
+
+    OffsetHashTableHeader &header() const {
+        return *reinterpret_cast<OffsetHashTableHeader *>(mBase);
+    }
+
+    size_t rowOf(const K &key) const {
+        return mHashFunc(key) % header().rowCount;
+    }
+
+    // returns the node holding key within the given row or NULL
+    Node *find(const size_t row, const K &key) const {
+        for (uint64_t offset = buckets()[row]; offset != 0;) {
+            Node *entry = node(offset);
+            if (entry->key == key) {
+                return entry;
+            }
+            offset = entry->next;
+        }
+        return NULL;
+    }
+
+    // links a node created by allocate() as first node of the given row
+    void pushFront(const size_t row, const uint64_t offset) {
+        node(offset)->next = buckets()[row];
+        buckets()[row] = offset;
+    }
+
+    // unlinks the node holding key from the given row and returns its offset, 0 if the key is not present
+    uint64_t unlink(const size_t row, const K &key) {
+        uint64_t *link = &buckets()[row];
+        while (*link != 0) {
+            Node *entry = node(*link);
+            if (entry->key == key) {
+                const uint64_t offset = *link;
+                *link = entry->next;
+                return offset;
+            }
+            link = &entry->next;
+        }
+        return 0;
+    }
+
+    // returns the offset of an unused node initialized with key and value, 0 if the region is full
+    uint64_t allocate(const K &key, const V &value) {
+        OffsetHashTableHeader &tableHeader = header();
+        uint64_t offset = tableHeader.freeList;
+        if (offset != 0) {
+            tableHeader.freeList = node(offset)->next;
+        } else if (tableHeader.nodeCount < tableHeader.nodeCapacity) {
+            offset = nodesOffset(tableHeader.rowCount) + tableHeader.nodeCount * sizeof(Node);
+            tableHeader.nodeCount++;
+        } else {
+            return 0;
+        }
+
+        Node *entry = node(offset);
+        entry->key = key;
+        entry->value = value;
+        entry->next = 0;
+        return offset;
+    }
+
+    // returns an unlinked node to the allocator
+    void release(const uint64_t offset) {
+        node(offset)->next = header().freeList;
+        header().freeList = offset;
+    }
+
+    // repairs the table after its owner died while modifying it. Every chain is cut at the first link that does not
+    // lead to an unvisited node of its row, the nodes no row reaches any longer are returned to the free list and the
+    // element count is recounted. Entries put or removed while the owner died may or may not be present afterwards
+    void recover() {
+        OffsetHashTableHeader &tableHeader = header();
+        tableHeader.nodeCount = std::min(tableHeader.nodeCount, tableHeader.nodeCapacity);
+        const size_t firstNode = nodesOffset(tableHeader.rowCount);
+        std::vector<bool> reachable(tableHeader.nodeCount, false);
+
+        uint64_t size = 0;
+        for (uint64_t row = 0; row < tableHeader.rowCount; row++) {
+            for (uint64_t *link = &buckets()[row]; *link != 0; link = &node(*link)->next) {
+                const uint64_t offset = *link;
+                const uint64_t slot = (offset - firstNode) / sizeof(Node);
+                if (offset < firstNode || (offset - firstNode) % sizeof(Node) != 0 || slot >= tableHeader.nodeCount
+                        || reachable[slot] || rowOf(node(offset)->key) != row) {
+                    *link = 0;
+                    break;
+                }
+                reachable[slot] = true;
+                size++;
+            }
+        }
+
+        tableHeader.freeList = 0;
+        for (uint64_t slot = tableHeader.nodeCount; slot > 0; slot--) {
+            if (!reachable[slot - 1]) {
+                release(firstNode + (slot - 1) * sizeof(Node));
+            }
+        }
+        tableHeader.size = size;
+    }
+
+    // removes all nodes
+    void clear() {
+        OffsetHashTableHeader &tableHeader = header();
+        std::memset(buckets(), 0, tableHeader.rowCount * sizeof(uint64_t));
+        tableHeader.nodeCount = 0;
+        tableHeader.freeList = 0;
+        tableHeader.size = 0;
+    }
+
+    Node *node(const uint64_t offset) const {
+        return reinterpret_cast<Node *>(mBase + offset);
+    }
+
+private:
+
+    // offset of the first node slot, aligned to a cache line
+    static size_t nodesOffset(const uint64_t rowCount) {
+        const size_t end = sizeof(OffsetHashTableHeader) + rowCount * sizeof(uint64_t);
+        return (end + 63) / 64 * 64;
+    }
+
+    uint64_t *buckets() const {
+        return reinterpret_cast<uint64_t *>(mBase + sizeof(OffsetHashTableHeader));
+    }
+
+    char *mBase;
+
+    F mHashFunc;
+};
+
+#endif /* OFFSETHASHTABLE_HPP_ */
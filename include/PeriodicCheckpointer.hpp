@@ -0,0 +1,59 @@
+#ifndef PERIODICCHECKPOINTER_HPP_
+#define PERIODICCHECKPOINTER_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// calls map.checkpoint(path) every interval on a background thread, which truncates the map's write-ahead log and
+// bounds the replay time after a crash. The thread is stopped by the destructor, which has to run before the map is
+// destroyed
+template<typename Map>
+class PeriodicCheckpointer {
+public:
+    PeriodicCheckpointer(Map &map, const std::string &path, const std::chrono::milliseconds interval) :
+            mMap(map), mPath(path), mInterval(interval), mStopped(false), mThread(&PeriodicCheckpointer::run, this) {
+    }
+
+    PeriodicCheckpointer(const PeriodicCheckpointer &) = delete;
+    PeriodicCheckpointer &operator=(const PeriodicCheckpointer &) = delete;
+
+    ~PeriodicCheckpointer() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopped = true;
+        }
+        mStopCondition.notify_one();
+        mThread.join();
+    }
+
+private:
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mStopCondition.wait_for(lock, mInterval, [this]() {
+            return mStopped;
+        })) {
+            lock.unlock();
+            mMap.checkpoint(mPath);
+            lock.lock();
+        }
+    }
+
+    Map &mMap;
+
+    const std::string mPath;
+
+    const std::chrono::milliseconds mInterval;
+
+    // set by the destructor, guarded by mMutex
+    bool mStopped;
+    std::mutex mMutex;
+    std::condition_variable mStopCondition;
+
+    std::thread mThread;
+};
+
+#endif /* PERIODICCHECKPOINTER_HPP_ */
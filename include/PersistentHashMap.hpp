@@ -0,0 +1,270 @@
+#ifndef PERSISTENTHASHMAP_HPP_
+#define PERSISTENTHASHMAP_HPP_
+
+#include "Constants.hpp"
+#include "OffsetHashTable.hpp"
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// HashMap variant whose buckets and nodes live in a memory-mapped file, linked by offsets instead of pointers. The table
+// survives restarts without any loading, residency is left to the page cache. Keys and values have to be trivially
+// copyable and the hash function has to be stable across processes. The row count is fixed when the file is created,
+// the node area grows by doubling the file. If the process died while the file was open, the next open repairs the
+// chains, see OffsetHashTable::recover(). The file is locked exclusively while it is open, so it is never mapped by two
+// maps at once
+template<typename K, typename V, typename F = std::hash<K> >
+class PersistentHashMap {
+public:
+
+    // opens the map stored in path or creates it with the given row count and initial node capacity. A file that is
+    // not empty and does not hold a map of the same key and value types, or that is held open by another map (in this
+    // or another process), is left untouched and isOpen() returns false
+    PersistentHashMap(const std::string &path, const int rowCount = constants::TABLE_SIZE,
+            const uint64_t initialCapacity = constants::TABLE_SIZE) :
+            mFd(-1), mBase(NULL), mRegionSize(0), mMutexList(NULL), mTableRowCount(0) {
+        mFd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (mFd < 0) {
+            return;
+        }
+
+        // the lock is released when the descriptor is closed, also if the process dies
+        if (::flock(mFd, LOCK_EX | LOCK_NB) != 0) {
+            return;
+        }
+
+        struct stat fileStat;
+        if (::fstat(mFd, &fileStat) != 0) {
+            return;
+        }
+
+        if (fileStat.st_size > 0) {
+            if (!map(fileStat.st_size)) {
+                return;
+            }
+            if (!OffsetHashTable<K, V, F>::isValid(mBase, mRegionSize, MAGIC)) {
+                unmap();
+                return;
+            }
+            if (mTable.header().clean != 1) {
+                // the process died while the file was open
+                mTable.recover();
+            }
+        } else {
+            const size_t regionSize = OffsetHashTable<K, V, F>::regionSize(rowCount, initialCapacity);
+            if (::ftruncate(mFd, regionSize) != 0 || !map(regionSize)) {
+                unmap();
+                return;
+            }
+            OffsetHashTable<K, V, F>::format(mBase, MAGIC, rowCount, initialCapacity);
+        }
+
+        // mark the file as in use until it is closed properly
+        mTable.header().clean = 0;
+        ::msync(mBase, sizeof(OffsetHashTableHeader), MS_SYNC);
+
+        mTableRowCount = mTable.header().rowCount;
+        mMutexList = new std::shared_timed_mutex *[mTableRowCount]();
+        for (int i = 0; i < mTableRowCount; i++) {
+            mMutexList[i] = new std::shared_timed_mutex;
+        }
+    }
+
+    PersistentHashMap(const PersistentHashMap &) = delete;
+    PersistentHashMap &operator=(const PersistentHashMap &) = delete;
+
+    ~PersistentHashMap() {
+        if (isOpen()) {
+            flush();
+            mTable.header().clean = 1;
+            ::msync(mBase, sizeof(OffsetHashTableHeader), MS_SYNC);
+        }
+        unmap();
+        if (mFd >= 0) {
+            ::close(mFd);
+        }
+
+        for (int i = 0; i < mTableRowCount; i++) {
+            delete mMutexList[i];
+        }
+        delete[] mMutexList;
+    }
+
+    // returns false if the file could not be opened or created, holds another map or is in use by another map, no other
+    // operation may be called in that case
+    bool isOpen() const {
+        return mBase != NULL;
+    }
+
+    bool get(const K &key, V &value) {
+        // acquire read lock for map instance
+        std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
+
+        const size_t index = mTable.rowOf(key);
+
+        // acquire shared lock for row
+        std::shared_lock < std::shared_timed_mutex > sharedLock(*this->mMutexList[index]);
+
+        const auto entry = mTable.find(index, key);
+        if (entry == NULL) {
+            return false;
+        }
+        value = entry->value;
+        return true;
+    }
+
+    // returns false if a new node was needed but the file could not be grown
+    bool put(const K &key, const V &value) {
+        while (!tryPut(key, value)) {
+            // the node area is exhausted, grow the file and retry
+            if (!grow()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void remove(const K &key) {
+        // acquire read lock for map instance
+        std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
+
+        const size_t index = mTable.rowOf(key);
+
+        // acquire exclusive row lock
+        std::lock_guard<std::shared_timed_mutex> lock(*this->mMutexList[index]);
+
+        const uint64_t offset = mTable.unlink(index, key);
+        if (offset != 0) {
+            mTable.header().size--;
+            std::lock_guard<std::mutex> allocatorLock(mAllocatorMutex);
+            mTable.release(offset);
+        }
+    }
+
+    void clear() {
+        const std::lock_guard<std::shared_timed_mutex> exclusiveMapLock(this->mMapMutex);
+        mTable.clear();
+    }
+
+    int size() {
+        return mTable.header().size;
+    }
+
+    // writes all modified pages back to the file
+    void flush() {
+        std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
+        ::msync(mBase, mRegionSize, MS_SYNC);
+    }
+
+private:
+
+    // "TPHM" in ASCII
+    static const uint32_t MAGIC = 0x4d485054;
+
+    // inserts or updates the entry, returns false if a new node was needed but the node area is exhausted
+    bool tryPut(const K &key, const V &value) {
+        // acquire read lock for map instance, the region is not remapped while it is held
+        std::shared_lock < std::shared_timed_mutex > sharedMapLock(this->mMapMutex);
+
+        const size_t index = mTable.rowOf(key);
+
+        // acquire exclusive lock on shared mutex to prevent modifications on the same row in the map
+        std::lock_guard<std::shared_timed_mutex> lock(*this->mMutexList[index]);
+
+        const auto entry = mTable.find(index, key);
+        if (entry != NULL) {
+            // just update the value
+            entry->value = value;
+            return true;
+        }
+
+        uint64_t offset;
+        {
+            std::lock_guard<std::mutex> allocatorLock(mAllocatorMutex);
+            offset = mTable.allocate(key, value);
+        }
+        if (offset == 0) {
+            return false;
+        }
+
+        mTable.pushFront(index, offset);
+        mTable.header().size++;
+        return true;
+    }
+
+    // doubles the node area of the file and remaps it, returns false if the file could not be extended or remapped. The
+    // new region is mapped before the old one is released, thus the map stays usable if either step fails
+    bool grow() {
+        const std::lock_guard<std::shared_timed_mutex> exclusiveMapLock(this->mMapMutex);
+
+        // another thread may have grown the file while this one was waiting for the lock
+        OffsetHashTableHeader &header = mTable.header();
+        if (header.freeList != 0 || header.nodeCount < header.nodeCapacity) {
+            return true;
+        }
+
+        const uint64_t nodeCapacity = std::max<uint64_t>(1, 2 * header.nodeCapacity);
+        const size_t oldRegionSize = mRegionSize;
+        const size_t regionSize = OffsetHashTable<K, V, F>::regionSize(header.rowCount, nodeCapacity);
+        if (::ftruncate(mFd, regionSize) != 0) {
+            return false;
+        }
+
+        // the offsets stay valid, only the base address changes
+        char *const oldBase = mBase;
+        if (!map(regionSize)) {
+            return false;
+        }
+        ::munmap(oldBase, oldRegionSize);
+        mTable.header().nodeCapacity = nodeCapacity;
+        return true;
+    }
+
+    // maps regionSize bytes of the file and attaches the table to them. On failure the current mapping is kept
+    bool map(const size_t regionSize) {
+        void *base = ::mmap(NULL, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+        if (base == MAP_FAILED) {
+            return false;
+        }
+        mBase = static_cast<char *>(base);
+        mRegionSize = regionSize;
+        mTable.attach(mBase);
+        return true;
+    }
+
+    void unmap() {
+        if (mBase != NULL) {
+            ::munmap(mBase, mRegionSize);
+            mBase = NULL;
+            mRegionSize = 0;
+        }
+    }
+
+    int mFd;
+
+    // start and size of the mapped file
+    char *mBase;
+    size_t mRegionSize;
+
+    // table within the mapped file
+    OffsetHashTable<K, V, F> mTable;
+
+    // holds a list with one mutex for every row in the map, enables per-row-locking
+    std::shared_timed_mutex **mMutexList;
+
+    int mTableRowCount;
+
+    // needed to control map-wide lockings, held exclusively while the file is remapped
+    std::shared_timed_mutex mMapMutex;
+
+    // guards the node allocator of the table
+    std::mutex mAllocatorMutex;
+};
+
+#endif /* PERSISTENTHASHMAP_HPP_ */
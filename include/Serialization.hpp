@@ -0,0 +1,148 @@
+#ifndef SERIALIZATION_HPP_
+#define SERIALIZATION_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary snapshot format written by HashMap::save() and read by HashMap::load(), all numbers in host byte order:
+//
+//   SnapshotFileHeader
+//   entryCount times: key, value (as written by Serializer<K> and Serializer<V>)
+//
+// Serializer<T> converts values of type T, trivially copyable types are stored as their object representation and
+// std::string as its length followed by its characters. Specialize Serializer for other key or value types, providing
+// FIXED_SIZE (0 for variable-sized encodings), write() and read() like the specializations below. Every encoding has
+// to occupy at least one byte, HashMap::load() relies on it to reject entry counts the file cannot hold.
+template<typename T, typename Enable = void>
+struct Serializer;
+
+template<typename T>
+struct Serializer<T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type> {
+    static const uint32_t FIXED_SIZE = sizeof(T);
+
+    static bool write(std::ostream &out, const T &value) {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        return out.good();
+    }
+
+    // reads a value from [cursor, end) and advances cursor behind it, returns false if the data is truncated
+    static bool read(const char *&cursor, const char *end, T &value) {
+        if (static_cast<size_t>(end - cursor) < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return true;
+    }
+};
+
+template<>
+struct Serializer<std::string> {
+    static const uint32_t FIXED_SIZE = 0;
+
+    static bool write(std::ostream &out, const std::string &value) {
+        const uint64_t length = value.size();
+        out.write(reinterpret_cast<const char *>(&length), sizeof(length));
+        out.write(value.data(), length);
+        return out.good();
+    }
+
+    static bool read(const char *&cursor, const char *end, std::string &value) {
+        uint64_t length;
+        if (!Serializer<uint64_t>::read(cursor, end, length) || static_cast<uint64_t>(end - cursor) < length) {
+            return false;
+        }
+        value.assign(cursor, length);
+        cursor += length;
+        return true;
+    }
+};
+
+struct SnapshotFileHeader {
+    // "THMP" in ASCII
+    static const uint32_t MAGIC = 0x504d4854;
+
+    // has to be incremented on every incompatible change of the format
+    static const uint32_t VERSION = 1;
+
+    uint32_t magic;
+    uint32_t version;
+
+    // fixed encoded sizes of key and value, 0 for variable-sized encodings. A file can only be loaded by a map whose
+    // serializers report the same sizes
+    uint32_t keySize;
+    uint32_t valueSize;
+
+    uint64_t entryCount;
+};
+
+// flushes the content of the file at path to the storage device, returns false on errors
+inline bool syncFile(const std::string &path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    const bool success = ::fsync(fd) == 0;
+    ::close(fd);
+    return success;
+}
+
+// read-only memory mapping of a complete file, the mapping is released on destruction
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path) :
+            mData(NULL), mSize(0) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+
+        struct stat fileStat;
+        if (::fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+            void *data = ::mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                // the file is read front to back exactly once
+                ::madvise(data, fileStat.st_size, MADV_SEQUENTIAL);
+                mData = static_cast<const char *>(data);
+                mSize = fileStat.st_size;
+            }
+        }
+
+        // the mapping stays valid after closing the descriptor
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        if (mData != NULL) {
+            ::munmap(const_cast<char *>(mData), mSize);
+        }
+    }
+
+    bool isOpen() const {
+        return mData != NULL;
+    }
+
+    const char *data() const {
+        return mData;
+    }
+
+    size_t size() const {
+        return mSize;
+    }
+
+private:
+    const char *mData;
+    size_t mSize;
+};
+
+#endif /* SERIALIZATION_HPP_ */
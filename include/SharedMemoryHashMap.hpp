@@ -0,0 +1,319 @@
+#ifndef SHAREDMEMORYHASHMAP_HPP_
+#define SHAREDMEMORYHASHMAP_HPP_
+
+#include "Constants.hpp"
+#include "OffsetHashTable.hpp"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// HashMap variant allocated in a POSIX shared memory segment, so several processes share a single copy of the table.
+// Nodes are linked by offsets (see OffsetHashTable), because every process maps the segment at a different address, and
+// rows are guarded by process-shared reader-writer locks stored in the segment instead of HashMap's per-row
+// shared_timed_mutex. Keys and values have to be trivially copyable and the hash function has to give the same results in
+// all processes. Row count and node capacity are fixed by the process creating the segment, put() fails once all nodes
+// are in use. A process dying while holding a row lock leaves the row locked
+template<typename K, typename V, typename F = std::hash<K> >
+class SharedMemoryHashMap {
+public:
+
+    // opens the segment with the given name (e.g. "/lookup") or creates it with the given row count and node capacity.
+    // Processes opening an existing segment wait until its creator has initialized it. A segment that cannot be sized
+    // or mapped by its creator is unlinked again
+    SharedMemoryHashMap(const std::string &name, const int rowCount = constants::TABLE_SIZE,
+            const uint64_t nodeCapacity = constants::TABLE_SIZE) :
+            mBase(NULL), mSegmentSize(0), mRowLocks(NULL), mAllocatorLock(NULL) {
+        int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0) {
+            if (!create(fd, rowCount, nodeCapacity)) {
+                // a segment that was never initialized would make every later open wait for the timeout and fail
+                ::shm_unlink(name.c_str());
+            }
+        } else {
+            fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+            if (fd >= 0) {
+                attach(fd);
+            }
+        }
+        if (fd >= 0) {
+            // the mapping stays valid after closing the descriptor
+            ::close(fd);
+        }
+    }
+
+    SharedMemoryHashMap(const SharedMemoryHashMap &) = delete;
+    SharedMemoryHashMap &operator=(const SharedMemoryHashMap &) = delete;
+
+    // unmaps the segment, the segment itself persists until unlink() has been called and all processes unmapped it
+    ~SharedMemoryHashMap() {
+        if (mBase != NULL) {
+            ::munmap(mBase, mSegmentSize);
+        }
+    }
+
+    // removes the segment name, processes that have it mapped keep using it
+    static bool unlink(const std::string &name) {
+        return ::shm_unlink(name.c_str()) == 0;
+    }
+
+    // returns false if the segment could not be created or attached, no other operation may be called in that case
+    bool isOpen() const {
+        return mBase != NULL;
+    }
+
+    bool get(const K &key, V &value) {
+        const size_t index = mTable.rowOf(key);
+
+        // acquire shared lock for row
+        const ReadLock lock(mRowLocks[index]);
+
+        const auto entry = mTable.find(index, key);
+        if (entry == NULL) {
+            return false;
+        }
+        value = entry->value;
+        return true;
+    }
+
+    // returns false if the key is new and all nodes of the segment are in use
+    bool put(const K &key, const V &value) {
+        const size_t index = mTable.rowOf(key);
+
+        // acquire exclusive lock to prevent modifications on the same row in the map
+        const WriteLock lock(mRowLocks[index]);
+
+        const auto entry = mTable.find(index, key);
+        if (entry != NULL) {
+            // just update the value
+            entry->value = value;
+            return true;
+        }
+
+        uint64_t offset;
+        {
+            const MutexLock allocatorLock(mAllocatorLock);
+            offset = mTable.allocate(key, value);
+        }
+        if (offset == 0) {
+            return false;
+        }
+
+        mTable.pushFront(index, offset);
+        mTable.header().size++;
+        return true;
+    }
+
+    void remove(const K &key) {
+        const size_t index = mTable.rowOf(key);
+
+        // acquire exclusive row lock
+        const WriteLock lock(mRowLocks[index]);
+
+        const uint64_t offset = mTable.unlink(index, key);
+        if (offset != 0) {
+            mTable.header().size--;
+            const MutexLock allocatorLock(mAllocatorLock);
+            mTable.release(offset);
+        }
+    }
+
+    // locks all rows in ascending order, so concurrent clear() calls cannot deadlock
+    void clear() {
+        const int rowCount = mTable.header().rowCount;
+        for (int i = 0; i < rowCount; i++) {
+            pthread_rwlock_wrlock(&mRowLocks[i]);
+        }
+        {
+            const MutexLock allocatorLock(mAllocatorLock);
+            mTable.clear();
+        }
+        for (int i = rowCount - 1; i >= 0; i--) {
+            pthread_rwlock_unlock(&mRowLocks[i]);
+        }
+    }
+
+    int size() {
+        return mTable.header().size;
+    }
+
+private:
+
+    // "SHMM" in ASCII
+    static const uint32_t MAGIC = 0x4d4d4853;
+
+    // maximum time a process opening the segment waits for its creator
+    static const int ATTACH_TIMEOUT_MILLISECONDS = 5000;
+
+    // control block at the start of the segment, followed by the table region and the locks
+    struct Control {
+        // set to 1 by the creator once the table and the locks are initialized
+        std::atomic<uint32_t> ready;
+    };
+
+    class ReadLock {
+    public:
+        explicit ReadLock(pthread_rwlock_t &lock) :
+                mLock(lock) {
+            pthread_rwlock_rdlock(&mLock);
+        }
+        ~ReadLock() {
+            pthread_rwlock_unlock(&mLock);
+        }
+    private:
+        pthread_rwlock_t &mLock;
+    };
+
+    class WriteLock {
+    public:
+        explicit WriteLock(pthread_rwlock_t &lock) :
+                mLock(lock) {
+            pthread_rwlock_wrlock(&mLock);
+        }
+        ~WriteLock() {
+            pthread_rwlock_unlock(&mLock);
+        }
+    private:
+        pthread_rwlock_t &mLock;
+    };
+
+    class MutexLock {
+    public:
+        explicit MutexLock(pthread_mutex_t *lock) :
+                mLock(lock) {
+            pthread_mutex_lock(mLock);
+        }
+        ~MutexLock() {
+            pthread_mutex_unlock(mLock);
+        }
+    private:
+        pthread_mutex_t *mLock;
+    };
+
+    // offsets of the table region and the locks within the segment, aligned to cache lines
+    static size_t tableOffset() {
+        return 64;
+    }
+
+    static size_t locksOffset(const uint64_t rowCount, const uint64_t nodeCapacity) {
+        const size_t end = tableOffset() + OffsetHashTable<K, V, F>::regionSize(rowCount, nodeCapacity);
+        return (end + 63) / 64 * 64;
+    }
+
+    static size_t segmentSize(const uint64_t rowCount, const uint64_t nodeCapacity) {
+        return locksOffset(rowCount, nodeCapacity) + sizeof(pthread_mutex_t) + rowCount * sizeof(pthread_rwlock_t);
+    }
+
+    // sizes and initializes a new segment, returns false if it could not be sized or mapped
+    bool create(const int fd, const uint64_t rowCount, const uint64_t nodeCapacity) {
+        const size_t segmentSize = SharedMemoryHashMap::segmentSize(rowCount, nodeCapacity);
+        if (::ftruncate(fd, segmentSize) != 0 || !map(fd, segmentSize)) {
+            return false;
+        }
+
+        const auto control = new (mBase) Control;
+        OffsetHashTable<K, V, F>::format(mBase + tableOffset(), MAGIC, rowCount, nodeCapacity);
+        bindLocks(rowCount, nodeCapacity);
+
+        pthread_mutexattr_t mutexAttributes;
+        pthread_mutexattr_init(&mutexAttributes);
+        pthread_mutexattr_setpshared(&mutexAttributes, PTHREAD_PROCESS_SHARED);
+        pthread_mutex_init(mAllocatorLock, &mutexAttributes);
+        pthread_mutexattr_destroy(&mutexAttributes);
+
+        pthread_rwlockattr_t rowLockAttributes;
+        pthread_rwlockattr_init(&rowLockAttributes);
+        pthread_rwlockattr_setpshared(&rowLockAttributes, PTHREAD_PROCESS_SHARED);
+        for (uint64_t i = 0; i < rowCount; i++) {
+            pthread_rwlock_init(&mRowLocks[i], &rowLockAttributes);
+        }
+        pthread_rwlockattr_destroy(&rowLockAttributes);
+
+        control->ready.store(1, std::memory_order_release);
+        return true;
+    }
+
+    void attach(const int fd) {
+        // wait until the creator has sized the segment and initialized its content
+        const auto deadline = std::chrono::steady_clock::now()
+                + std::chrono::milliseconds(ATTACH_TIMEOUT_MILLISECONDS);
+        struct stat segmentStat;
+        while (::fstat(fd, &segmentStat) == 0 && static_cast<size_t>(segmentStat.st_size) < tableOffset()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (!map(fd, segmentStat.st_size)) {
+            return;
+        }
+
+        const auto control = reinterpret_cast<Control *>(mBase);
+        while (control->ready.load(std::memory_order_acquire) != 1) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                unmap();
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        const char *tableBase = mBase + tableOffset();
+        if (!OffsetHashTable<K, V, F>::isValid(tableBase, mSegmentSize - tableOffset(), MAGIC)) {
+            unmap();
+            return;
+        }
+        const auto header = reinterpret_cast<const OffsetHashTableHeader *>(tableBase);
+        if (segmentSize(header->rowCount, header->nodeCapacity) > mSegmentSize) {
+            unmap();
+            return;
+        }
+        bindLocks(header->rowCount, header->nodeCapacity);
+    }
+
+    bool map(const int fd, const size_t segmentSize) {
+        void *base = ::mmap(NULL, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            return false;
+        }
+        mBase = static_cast<char *>(base);
+        mSegmentSize = segmentSize;
+        mTable.attach(mBase + tableOffset());
+        return true;
+    }
+
+    void unmap() {
+        ::munmap(mBase, mSegmentSize);
+        mBase = NULL;
+        mSegmentSize = 0;
+    }
+
+    void bindLocks(const uint64_t rowCount, const uint64_t nodeCapacity) {
+        char *locks = mBase + locksOffset(rowCount, nodeCapacity);
+        mAllocatorLock = reinterpret_cast<pthread_mutex_t *>(locks);
+        mRowLocks = reinterpret_cast<pthread_rwlock_t *>(locks + sizeof(pthread_mutex_t));
+    }
+
+    // start and size of the mapped segment
+    char *mBase;
+    size_t mSegmentSize;
+
+    // table within the segment
+    OffsetHashTable<K, V, F> mTable;
+
+    // process-shared locks within the segment, one for every row and one guarding the node allocator
+    pthread_rwlock_t *mRowLocks;
+    pthread_mutex_t *mAllocatorLock;
+};
+
+template<typename K, typename V, typename F>
+const uint32_t SharedMemoryHashMap<K, V, F>::MAGIC;
+
+template<typename K, typename V, typename F>
+const int SharedMemoryHashMap<K, V, F>::ATTACH_TIMEOUT_MILLISECONDS;
+
+#endif /* SHAREDMEMORYHASHMAP_HPP_ */
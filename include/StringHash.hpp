@@ -0,0 +1,34 @@
+#ifndef STRINGHASH_HPP_
+#define STRINGHASH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// transparent hash function for std::string keys: hashes the characters of std::string, C strings and every type
+// providing data() and size() to the same value. Together with std::equal_to<> it enables the heterogeneous get(),
+// contains() and remove() of HashMap<std::string, V, StringHash, std::equal_to<> >, looking up a const char * then
+// neither allocates nor copies a temporary std::string. 64-bit FNV-1a
+struct StringHash {
+    typedef void is_transparent;
+
+    template<typename S>
+    size_t operator()(const S &s) const {
+        return hash(s.data(), s.size());
+    }
+
+    size_t operator()(const char *s) const {
+        return hash(s, std::strlen(s));
+    }
+
+    static size_t hash(const char *data, const size_t length) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < length; i++) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ULL;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+#endif /* STRINGHASH_HPP_ */
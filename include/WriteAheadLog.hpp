@@ -0,0 +1,327 @@
+#ifndef WRITEAHEADLOG_HPP_
+#define WRITEAHEADLOG_HPP_
+
+#include "Serialization.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// log hook of a HashMap. The map only calls this interface, so maps without a log attached do not depend on a
+// Serializer for their key and value types, only WriteAheadLog itself does
+template<typename K, typename V>
+class MapLog {
+public:
+    virtual ~MapLog() {
+    }
+
+    virtual uint64_t appendPut(const K &key, const V &value) = 0;
+    virtual uint64_t appendRemove(const K &key) = 0;
+    virtual uint64_t appendClear() = 0;
+    virtual bool sync(uint64_t lsn) = 0;
+    virtual uint64_t rotate() = 0;
+    virtual void truncate(uint64_t segment) = 0;
+};
+
+// Write-ahead log for a HashMap, see HashMap::setWriteAheadLog(). The log is a sequence of segment files named
+// <path>.<segment number>, every record is stored as
+//
+//   uint32_t payload length, uint32_t FNV-1a checksum of the payload, payload: uint8_t type, key [, value]
+//
+// with keys and values encoded by Serializer. Records are appended to an in-memory buffer and made durable by group
+// commit: the first thread waiting in sync() becomes the leader and writes and fsyncs everything appended so far in one
+// batch, threads appending meanwhile are served by the next batch. A checkpoint rotates to a new segment and deletes
+// the segments it covers once it has been written, see HashMap::checkpoint(). If writing or syncing a batch fails, the
+// log enters a failed state: the records of that batch are lost, thus no later sync() may report them as durable, and
+// every sync() and rotate() fails from then on. Attach a new log and checkpoint the map to recover
+template<typename K, typename V>
+class WriteAheadLog: public MapLog<K, V> {
+public:
+
+    enum RecordType {
+        PUT = 1, REMOVE = 2, CLEAR = 3
+    };
+
+    // opens a new segment behind all segments already present for path, these are left for replay()
+    explicit WriteAheadLog(const std::string &path) :
+            mPath(path), mFd(-1), mNextLsn(1), mDurableLsn(0), mFlushing(false), mFailed(false), mFlushCount(0) {
+        const auto segments = listSegments();
+        mSegment = segments.empty() ? 1 : segments.back() + 1;
+        openSegment();
+    }
+
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+    ~WriteAheadLog() {
+        if (mFd >= 0) {
+            sync(mNextLsn - 1);
+            ::close(mFd);
+        }
+    }
+
+    // returns false if the current segment could not be created
+    bool isOpen() const {
+        return mFd >= 0;
+    }
+
+    // the append functions return the log sequence number of the record, which has to be passed to sync() to wait for
+    // its durability. They are called by the map while holding the row lock, so the log order matches the apply order
+    uint64_t appendPut(const K &key, const V &value) override {
+        std::ostringstream payload;
+        payload.put(PUT);
+        Serializer<K>::write(payload, key);
+        Serializer<V>::write(payload, value);
+        return append(payload.str());
+    }
+
+    uint64_t appendRemove(const K &key) override {
+        std::ostringstream payload;
+        payload.put(REMOVE);
+        Serializer<K>::write(payload, key);
+        return append(payload.str());
+    }
+
+    uint64_t appendClear() override {
+        return append(std::string(1, CLEAR));
+    }
+
+    // blocks until the record with the given sequence number and all records before it are durable, returns false if
+    // the log has failed
+    bool sync(const uint64_t lsn) override {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (mDurableLsn < lsn) {
+            if (mFailed) {
+                return false;
+            }
+            if (mFlushing) {
+                mFlushed.wait(lock);
+                continue;
+            }
+
+            // become the leader and flush everything appended so far as one batch
+            mFlushing = true;
+            std::string batch;
+            batch.swap(mBuffer);
+            const uint64_t batchLsn = mNextLsn - 1;
+            const int fd = mFd;
+            lock.unlock();
+
+            const bool success = writeAll(fd, batch) && syncDescriptor(fd);
+
+            lock.lock();
+            mFlushing = false;
+            mFlushCount++;
+            if (success) {
+                mDurableLsn = batchLsn;
+            } else {
+                mFailed = true;
+            }
+            mFlushed.notify_all();
+        }
+        return true;
+    }
+
+    // true once writing or syncing a batch has failed
+    bool failed() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mFailed;
+    }
+
+    // makes all records durable and starts a new segment, returns its number or 0 if the log has failed. Records
+    // appended afterwards are written to the new segment. Called by HashMap::checkpoint() while the map is locked
+    // exclusively
+    uint64_t rotate() override {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mFlushed.wait(lock, [this]() {
+            return !mFlushing;
+        });
+        if (mFailed) {
+            return 0;
+        }
+
+        mFlushCount++;
+        if (!writeAll(mFd, mBuffer) || !syncDescriptor(mFd)) {
+            mFailed = true;
+            mFlushed.notify_all();
+            return 0;
+        }
+        mDurableLsn = mNextLsn - 1;
+        mBuffer.clear();
+        mFlushed.notify_all();
+
+        ::close(mFd);
+        mSegment++;
+        openSegment();
+        return mSegment;
+    }
+
+    // deletes all segments before the given one, called once a checkpoint covering them is durable
+    void truncate(const uint64_t segment) override {
+        for (const auto number : listSegments()) {
+            if (number < segment) {
+                std::remove(segmentPath(number).c_str());
+            }
+        }
+    }
+
+    // applies the records of all segments written before this log was opened to map, in log order. The map must not
+    // have this log attached while replaying. A record that is truncated or fails its checksum ends the replay of its
+    // segment, because it can only stem from a crash while writing the tail
+    template<typename Map>
+    void replay(Map &map) const {
+        for (const auto number : listSegments()) {
+            if (number >= mSegment) {
+                break;
+            }
+            replaySegment(segmentPath(number), map);
+        }
+    }
+
+    // number of batches written so far, the ratio of sync() calls to flushes shows the effect of group commit
+    uint64_t flushCount() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mFlushCount;
+    }
+
+private:
+
+    uint64_t append(const std::string &payload) {
+        const uint32_t header[2] = { static_cast<uint32_t>(payload.size()), checksum(payload.data(), payload.size()) };
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBuffer.append(reinterpret_cast<const char *>(header), sizeof(header));
+        mBuffer.append(payload);
+        return mNextLsn++;
+    }
+
+    template<typename Map>
+    static void replaySegment(const std::string &path, Map &map) {
+        const MappedFile file(path);
+        if (!file.isOpen()) {
+            return;
+        }
+
+        const char *cursor = file.data();
+        const char *end = file.data() + file.size();
+        uint32_t header[2];
+        while (static_cast<size_t>(end - cursor) >= sizeof(header)) {
+            std::memcpy(header, cursor, sizeof(header));
+            const char *payload = cursor + sizeof(header);
+            if (static_cast<size_t>(end - payload) < header[0] || checksum(payload, header[0]) != header[1]) {
+                return;
+            }
+            cursor = payload + header[0];
+
+            const char *payloadEnd = cursor;
+            const char type = *payload++;
+            K key = K();
+            V value = V();
+            if (type == PUT && Serializer<K>::read(payload, payloadEnd, key)
+                    && Serializer<V>::read(payload, payloadEnd, value)) {
+                map.put(key, value);
+            } else if (type == REMOVE && Serializer<K>::read(payload, payloadEnd, key)) {
+                map.remove(key);
+            } else if (type == CLEAR) {
+                map.clear();
+            }
+        }
+    }
+
+    // FNV-1a
+    static uint32_t checksum(const char *data, const size_t length) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < length; i++) {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    static bool writeAll(const int fd, const std::string &data) {
+        size_t written = 0;
+        while (written < data.size()) {
+            const ssize_t result = ::write(fd, data.data() + written, data.size() - written);
+            if (result < 0) {
+                return false;
+            }
+            written += result;
+        }
+        return true;
+    }
+
+    static bool syncDescriptor(const int fd) {
+#ifdef __linux__
+        return ::fdatasync(fd) == 0;
+#else
+        return ::fsync(fd) == 0;
+#endif
+    }
+
+    void openSegment() {
+        mFd = ::open(segmentPath(mSegment).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    }
+
+    std::string segmentPath(const uint64_t number) const {
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".%010llu", static_cast<unsigned long long>(number));
+        return mPath + suffix;
+    }
+
+    // numbers of all segments of this log in ascending order
+    std::vector<uint64_t> listSegments() const {
+        const size_t separator = mPath.rfind('/');
+        const std::string directory = separator == std::string::npos ? "." : mPath.substr(0, separator + 1);
+        const std::string prefix = (separator == std::string::npos ? mPath : mPath.substr(separator + 1)) + ".";
+
+        std::vector<uint64_t> segments;
+        DIR *dir = ::opendir(directory.c_str());
+        if (dir == NULL) {
+            return segments;
+        }
+        while (const dirent *entry = ::readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0
+                    && name.find_first_not_of("0123456789", prefix.size()) == std::string::npos) {
+                segments.push_back(std::strtoull(name.c_str() + prefix.size(), NULL, 10));
+            }
+        }
+        ::closedir(dir);
+        std::sort(segments.begin(), segments.end());
+        return segments;
+    }
+
+    const std::string mPath;
+
+    // descriptor and number of the segment currently appended to
+    int mFd;
+    uint64_t mSegment;
+
+    // guards all members below
+    std::mutex mMutex;
+
+    // records appended but not yet written
+    std::string mBuffer;
+
+    // sequence number of the next record and of the last durable record
+    uint64_t mNextLsn;
+    uint64_t mDurableLsn;
+
+    // true while a leader writes a batch, waiting threads are notified when it is done
+    bool mFlushing;
+    std::condition_variable mFlushed;
+
+    // set once a batch could not be written, see failed()
+    bool mFailed;
+
+    uint64_t mFlushCount;
+};
+
+#endif /* WRITEAHEADLOG_HPP_ */
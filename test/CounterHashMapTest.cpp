@@ -0,0 +1,141 @@
+/*
+ * CounterHashMapTest.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: Patrick Gunia
+ */
+
+#include <gtest/gtest.h>
+#include <CounterHashMap.hpp>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+TEST(CounterHashMapTest, Increment) {
+    CounterHashMap<string> map;
+    EXPECT_EQ(1, map.increment("a"));
+    EXPECT_EQ(6, map.increment("a", 5));
+    EXPECT_EQ(-2, map.increment("b", -2));
+
+    int64_t value;
+    EXPECT_EQ(true, map.get("a", value));
+    EXPECT_EQ(6, value);
+    EXPECT_EQ(false, map.get("c", value));
+    EXPECT_EQ(2, map.size());
+
+    map.remove("a");
+    EXPECT_EQ(false, map.contains("a"));
+    EXPECT_EQ(1, map.increment("a"));
+
+    int64_t sum = 0;
+    map.for_each([&](const string &, const int64_t counter) {
+        sum += counter;
+    });
+    EXPECT_EQ(-1, sum);
+}
+
+TEST(CounterHashMapTest, ConcurrentIncrement) {
+    CounterHashMap<int> map(7);
+    const int threadCount = 4;
+    const int keyCount = 100;
+    const int rounds = 1000;
+
+    // all threads insert and increment the same keys, no increment may be lost
+    vector<thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.push_back(thread([&map, keyCount, rounds]() {
+            for (int round = 0; round < rounds; round++) {
+                for (int key = 0; key < keyCount; key++) {
+                    map.increment(key, key);
+                }
+            }
+        }));
+    }
+    // resizing concurrently moves the counters between rows
+    map.resize(101);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(keyCount, map.size());
+    for (int key = 0; key < keyCount; key++) {
+        int64_t value;
+        ASSERT_EQ(true, map.get(key, value));
+        EXPECT_EQ(static_cast<int64_t>(key) * threadCount * rounds, value);
+    }
+}
+
+TEST(CounterHashMapTest, Combiner) {
+    CounterHashMap<int> map;
+    {
+        CounterHashMap<int>::Combiner combiner(map, 3, chrono::hours(1));
+        combiner.increment(1);
+        combiner.increment(1, 4);
+        combiner.increment(2);
+
+        // buffered deltas are not visible before the flush
+        int64_t value;
+        EXPECT_EQ(false, map.get(1, value));
+        EXPECT_EQ(2u, combiner.pending());
+
+        combiner.flush();
+        EXPECT_EQ(true, map.get(1, value));
+        EXPECT_EQ(5, value);
+        EXPECT_EQ(0u, combiner.pending());
+
+        // the third distinct key triggers the flush
+        combiner.increment(1);
+        combiner.increment(2);
+        combiner.increment(3);
+        EXPECT_EQ(0u, combiner.pending());
+        EXPECT_EQ(true, map.get(1, value));
+        EXPECT_EQ(6, value);
+
+        combiner.increment(4);
+    }
+    // flushed on destruction
+    EXPECT_EQ(4, map.size());
+
+    // a delta older than maxDelay is flushed by a later increment
+    CounterHashMap<int>::Combiner combiner(map, 100, chrono::milliseconds(1));
+    combiner.increment(5);
+    this_thread::sleep_for(chrono::milliseconds(5));
+    for (int i = 0; i < CounterHashMap<int>::Combiner::CLOCK_CHECK_INTERVAL; i++) {
+        combiner.increment(5);
+    }
+    int64_t value;
+    EXPECT_EQ(true, map.get(5, value));
+    EXPECT_LT(1, value);
+    combiner.flush();
+    EXPECT_EQ(true, map.get(5, value));
+    EXPECT_EQ(CounterHashMap<int>::Combiner::CLOCK_CHECK_INTERVAL + 1, value);
+}
+
+TEST(CounterHashMapTest, ConcurrentCombiners) {
+    CounterHashMap<int> map;
+    const int threadCount = 4;
+    const int increments = 100000;
+    const int keyCount = 10;
+
+    vector<thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.push_back(thread([&map, increments, keyCount]() {
+            CounterHashMap<int>::Combiner combiner(map, 4);
+            for (int i = 0; i < increments; i++) {
+                combiner.increment(i % keyCount);
+            }
+        }));
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (int key = 0; key < keyCount; key++) {
+        int64_t value;
+        ASSERT_EQ(true, map.get(key, value));
+        EXPECT_EQ(threadCount * increments / keyCount, value);
+    }
+}
@@ -0,0 +1,110 @@
+/*
+ * FlatIntegerHashMapTest.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: Patrick Gunia
+ */
+
+#include <gtest/gtest.h>
+#include <FlatIntegerHashMap.hpp>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+TEST(FlatIntegerHashMapTest, PutGetRemove) {
+    FlatIntegerHashMap<uint64_t, uint64_t> map(4);
+    EXPECT_EQ(true, map.put(1, 10));
+    EXPECT_EQ(true, map.put(2, 20));
+    EXPECT_EQ(true, map.put(1, 11));
+
+    uint64_t result;
+    EXPECT_EQ(true, map.get(1, result));
+    EXPECT_EQ(11u, result);
+    EXPECT_EQ(2, map.size());
+
+    map.remove(1);
+    EXPECT_EQ(false, map.get(1, result));
+    EXPECT_EQ(false, map.contains(1));
+    EXPECT_EQ(true, map.contains(2));
+    EXPECT_EQ(1, map.size());
+
+    // a removed key can be put again
+    EXPECT_EQ(true, map.put(1, 12));
+    EXPECT_EQ(true, map.get(1, result));
+    EXPECT_EQ(12u, result);
+
+    // the sentinels are rejected
+    const uint64_t emptyKey = FlatIntegerHashMap<uint64_t, uint64_t>::EMPTY_KEY;
+    EXPECT_EQ(false, map.put(emptyKey, 0));
+    EXPECT_EQ(false, map.get(emptyKey, result));
+
+    map.clear();
+    EXPECT_EQ(0, map.size());
+    EXPECT_EQ(false, map.contains(2));
+}
+
+TEST(FlatIntegerHashMapTest, Grow) {
+    FlatIntegerHashMap<int, long> map(4);
+    const int numberEntries = 10000;
+    for (int i = 0; i < numberEntries; i++) {
+        map.put(i, 2L * i);
+    }
+    // removed slots are reclaimed while growing
+    for (int i = 0; i < numberEntries; i += 2) {
+        map.remove(i);
+    }
+    for (int i = numberEntries; i < 2 * numberEntries; i++) {
+        map.put(i, 2L * i);
+    }
+    EXPECT_EQ(numberEntries + numberEntries / 2, map.size());
+
+    int count = 0;
+    map.for_each([&](const int key, const long value) {
+        EXPECT_EQ(2L * key, value);
+        EXPECT_TRUE(key % 2 == 1 || key >= numberEntries);
+        count++;
+    });
+    EXPECT_EQ(map.size(), count);
+}
+
+TEST(FlatIntegerHashMapTest, ConcurrentPut) {
+    FlatIntegerHashMap<long, long> map(16);
+    const int threadCount = 4;
+    const long keysPerThread = 20000;
+
+    // the threads put overlapping key ranges, so they race for the same slots while the table grows
+    vector<thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.push_back(thread([&map, t, keysPerThread]() {
+            for (long i = 0; i < keysPerThread; i++) {
+                const long key = t * keysPerThread / 2 + i;
+                map.put(key, key);
+                long value;
+                EXPECT_EQ(true, map.get(key, value));
+            }
+        }));
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    const long keyCount = (threadCount + 1) * keysPerThread / 2;
+    EXPECT_EQ(keyCount, map.size());
+    for (long key = 0; key < keyCount; key++) {
+        long value;
+        ASSERT_EQ(true, map.get(key, value));
+        EXPECT_EQ(key, value);
+    }
+}
+
+TEST(FlatIntegerHashMapTest, AutoHashMap) {
+    EXPECT_TRUE((is_same<AutoHashMap<uint64_t, uint64_t>, FlatIntegerHashMap<uint64_t, uint64_t> >::value));
+    EXPECT_TRUE((is_same<AutoHashMap<int, string>, HashMap<int, string> >::value));
+
+    AutoHashMap<int, string> map(10);
+    map.put(1, "one");
+    string result;
+    EXPECT_EQ(true, map.get(1, result));
+}
@@ -0,0 +1,117 @@
+/*
+ * HashMapStatsTest.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: Patrick Gunia
+ */
+
+// this test unit compiles the map with instrumentation, the other units without
+#define HASHMAP_STATS
+
+#include <gtest/gtest.h>
+#include <HashMap.hpp>
+#include <chrono>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    // the map must not be instantiated with the same arguments by units compiled without HASHMAP_STATS, thus this
+    // unit uses its own hash function
+    struct StatsTestHash {
+        size_t operator()(const int key) const {
+            return static_cast<size_t>(key);
+        }
+    };
+
+    typedef HashMap<int, int, StatsTestHash> InstrumentedMap;
+}
+
+TEST(HashMapStatsTest, Counters) {
+    InstrumentedMap map(10);
+    const int numberEntries = 100;
+
+    for (int i = 0; i < numberEntries; i++) {
+        map.put(i, i);
+    }
+    int result;
+    for (int i = 0; i < 2 * numberEntries; i++) {
+        map.get(i, result);
+    }
+
+    auto stats = map.stats();
+    EXPECT_EQ(true, stats.enabled);
+    EXPECT_EQ(uint64_t(numberEntries), stats.getHits);
+    EXPECT_EQ(uint64_t(numberEntries), stats.getMisses);
+
+    // every put() and get() locks one row
+    ASSERT_EQ(10u, stats.rowLockAcquisitions.size());
+    EXPECT_EQ(uint64_t(3 * numberEntries),
+            accumulate(stats.rowLockAcquisitions.begin(), stats.rowLockAcquisitions.end(), uint64_t(0)));
+    EXPECT_EQ(uint64_t(3 * numberEntries), stats.rowLockWait.count());
+    EXPECT_EQ(uint64_t(3 * numberEntries), stats.mapLockWait.count());
+    EXPECT_LE(stats.rowLockWait.percentile(0.5), stats.rowLockWait.percentile(1.0));
+
+    // the identity hash spreads the keys evenly over the 10 rows
+    ASSERT_EQ(11u, stats.chainLengths.size());
+    EXPECT_EQ(10u, stats.chainLengths[10]);
+
+    map.resize(100);
+    stats = map.stats();
+    EXPECT_EQ(1u, stats.resizeCount);
+    EXPECT_EQ(stats.resizeNanosecondsLast, stats.resizeNanosecondsTotal);
+    EXPECT_EQ(100u, stats.rowLockAcquisitions.size());
+    ASSERT_EQ(2u, stats.chainLengths.size());
+    EXPECT_EQ(100u, stats.chainLengths[1]);
+}
+
+TEST(HashMapStatsTest, MissesStayReadOnly) {
+    InstrumentedMap map(10);
+    map.put(1, 1, chrono::milliseconds(1));
+    map.put(2, 2, chrono::hours(1));
+    this_thread::sleep_for(chrono::milliseconds(5));
+
+    // misses of absent keys lock their row once, only the miss on the expired entry locks it again to reclaim it
+    int result;
+    for (int i = 3; i < 13; i++) {
+        EXPECT_EQ(false, map.get(i, result));
+    }
+    EXPECT_EQ(false, map.get(1, result));
+    EXPECT_EQ(1, map.size());
+
+    const auto stats = map.stats();
+    EXPECT_EQ(uint64_t(2 + 10 + 2),
+            accumulate(stats.rowLockAcquisitions.begin(), stats.rowLockAcquisitions.end(), uint64_t(0)));
+}
+
+TEST(HashMapStatsTest, CountersOfAllThreads) {
+    InstrumentedMap map(10);
+    const int numberThreads = 2 * HashMapStatsRecorder::SHARD_COUNT;
+    const int iterations = 100;
+    map.put(1, 1);
+
+    // more threads than shards, so some of them share a shard
+    vector<thread> threads;
+    for (int t = 0; t < numberThreads; t++) {
+        threads.emplace_back([&map, iterations]() {
+            int result;
+            for (int i = 0; i < iterations; i++) {
+                map.get(1, result);
+                map.get(2, result);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    const auto stats = map.stats();
+    EXPECT_EQ(uint64_t(numberThreads * iterations), stats.getHits);
+    EXPECT_EQ(uint64_t(numberThreads * iterations), stats.getMisses);
+    EXPECT_EQ(uint64_t(1 + 2 * numberThreads * iterations), stats.mapLockWait.count());
+    EXPECT_EQ(uint64_t(1 + 2 * numberThreads * iterations),
+            accumulate(stats.rowLockAcquisitions.begin(), stats.rowLockAcquisitions.end(), uint64_t(0)));
+}
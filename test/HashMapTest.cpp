@@ -7,7 +7,18 @@
 
 #include <gtest/gtest.h>
 #include <HashMap.hpp>
+#include <ExpirySweeper.hpp>
+#include <HashFunctions.hpp>
+#include <StringHash.hpp>
 #include <thread>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <set>
+#include <stdexcept>
+#include <type_traits>
 
 using namespace std;
 
@@ -156,6 +167,871 @@ TEST(HashMapTest, Resize) {
     }
 }
 
+TEST(HashMapTest, ResizeParallel) {
+    HashMap<int, string> map;
+    const int numberEntries = 1000;
+
+    for (int i = 0; i < numberEntries; i++) {
+        map.put(i, to_string(i));
+    }
+
+    // grow and shrink the table using several worker threads, the row count is deliberately not divisible by the thread count
+    map.resize(997, 4);
+    map.resize(13, 3);
+
+    EXPECT_EQ(numberEntries, map.size());
+
+    string result;
+    for (int i = 0; i < numberEntries; i++) {
+        const bool success = map.get(i, result);
+        EXPECT_EQ(true, success);
+        EXPECT_EQ(to_string(i), result);
+    }
+}
+
+TEST(HashMapTest, BulkConstructor) {
+    const int numberEntries = 1000;
+    vector<pair<int, string> > entries;
+    for (int i = 0; i < numberEntries; i++) {
+        entries.push_back(make_pair(i, to_string(i)));
+    }
+    // duplicate key, the last pair should win
+    entries.push_back(make_pair(0, string("last")));
+
+    HashMap<int, string> map(entries.begin(), entries.end(), 4);
+    EXPECT_EQ(numberEntries, map.size());
+
+    string result;
+    EXPECT_EQ(true, map.get(0, result));
+    EXPECT_EQ("last", result);
+    for (int i = 1; i < numberEntries; i++) {
+        EXPECT_EQ(true, map.get(i, result));
+        EXPECT_EQ(to_string(i), result);
+    }
+
+    // a range without random access is split into slices as well, the duplicate still ends up in the last slice
+    const list<pair<int, string> > listed(entries.begin(), entries.end());
+    HashMap<int, string> fromList(listed.begin(), listed.end(), 3);
+    EXPECT_EQ(numberEntries, fromList.size());
+    EXPECT_EQ(true, fromList.get(0, result));
+    EXPECT_EQ("last", result);
+}
+
+// seeded hash converting implicitly from the seed
+struct ImplicitlySeededHash {
+    ImplicitlySeededHash(const int seed = 0) :
+            seed(seed) {
+    }
+
+    size_t operator()(const int key) const {
+        return static_cast<size_t>(key ^ seed);
+    }
+
+    int seed;
+};
+
+TEST(HashMapTest, SizeAndHashFunctionConstructor) {
+    // two ints are no iterator range
+    static_assert(!std::is_constructible<HashMap<int, int>, int, int>::value, "ints taken for an iterator range");
+
+    HashMap<int, int, ImplicitlySeededHash> map(10, 4);
+    map.put(1, 10);
+    int result;
+    EXPECT_EQ(true, map.get(1, result));
+    EXPECT_EQ(10, result);
+}
+
+TEST(HashMapTest, Reserve) {
+    HashMap<int, string> map;
+    const string value = "value";
+    const int numberEntries = 500;
+
+    for (int i = 0; i < numberEntries; i++) {
+        map.put(i, value);
+    }
+
+    map.reserve(10000, 2);
+    // reserving less than the current capacity must not shrink the table
+    map.reserve(10);
+
+    EXPECT_EQ(numberEntries, map.size());
+    string result;
+    for (int i = 0; i < numberEntries; i++) {
+        EXPECT_EQ(true, map.get(i, result));
+        EXPECT_EQ(value, result);
+    }
+}
+
+TEST(HashMapTest, ForEach) {
+    HashMap<int, int> map;
+    const int numberEntries = 1000;
+
+    for (int i = 0; i < numberEntries; i++) {
+        map.put(i, i);
+    }
+
+    long sum = 0;
+    int count = 0;
+    map.for_each([&](const int &key, const int &value) {
+        EXPECT_EQ(key, value);
+        sum += value;
+        count++;
+    });
+
+    EXPECT_EQ(numberEntries, count);
+    EXPECT_EQ(numberEntries * (numberEntries - 1L) / 2, sum);
+}
+
+TEST(HashMapTest, Iterator) {
+    HashMap<int, string> map;
+    const int numberEntries = 1000;
+
+    // an empty map yields no entries
+    EXPECT_TRUE(map.begin() == map.end());
+
+    for (int i = 0; i < numberEntries; i++) {
+        map.put(i, to_string(i));
+    }
+
+    vector<bool> seen(numberEntries, false);
+    bool written = false;
+    for (const auto &entry : map) {
+        // entries written meanwhile may or may not be seen
+        if (entry.first < numberEntries) {
+            EXPECT_EQ(to_string(entry.first), entry.second);
+            EXPECT_FALSE(seen[entry.first]);
+            seen[entry.first] = true;
+        }
+
+        // writers on other threads are not blocked while iterating, the iterating thread must not call the map itself
+        if (!written) {
+            thread writer([&map, numberEntries]() {
+                for (int i = 0; i < numberEntries; i++) {
+                    map.put(numberEntries + i, to_string(i));
+                }
+            });
+            writer.join();
+            written = true;
+        }
+    }
+    EXPECT_EQ(numberEntries, count(seen.begin(), seen.end(), true));
+
+    // copies advance independently and share the map lock
+    {
+        auto it = map.begin();
+        const auto copy = it++;
+        EXPECT_TRUE(it != copy);
+        const int secondKey = it->first;
+        EXPECT_NE(secondKey, copy->first);
+        ++it;
+        EXPECT_NE(secondKey, it->first);
+    }
+
+    // the iterators can construct containers
+    const vector<pair<int, string> > entries(map.begin(), map.end());
+    EXPECT_EQ(size_t(2 * numberEntries), entries.size());
+
+    // the iterator has released its map lock, thus resizing is possible again
+    map.resize(10);
+    EXPECT_EQ(2 * numberEntries, map.size());
+}
+
+TEST(HashMapTest, ParallelForEach) {
+    HashMap<int, int> map(1000);
+    const int numberEntries = 10000;
+
+    for (int i = 0; i < numberEntries; i++) {
+        map.put(i, 1);
+    }
+
+    std::atomic<int> count(0);
+    map.parallel_for_each([&](const int &, const int &value) {
+        count += value;
+    }, 4);
+
+    EXPECT_EQ(numberEntries, count);
+}
+
+TEST(HashMapTest, ParallelReduce) {
+    HashMap<int, int> map(1000);
+    const int numberEntries = 10000;
+
+    for (int i = 0; i < numberEntries; i++) {
+        map.put(i, i);
+    }
+
+    const long sum = map.parallel_reduce([](const int &, const int &value) {
+        return static_cast<long>(value);
+    }, [](const long a, const long b) {
+        return a + b;
+    }, 0L, 4);
+
+    EXPECT_EQ(numberEntries * (numberEntries - 1L) / 2, sum);
+}
+
+TEST(HashMapTest, SnapshotIsolation) {
+    HashMap<int, string> map;
+    const int numberEntries = 1000;
+
+    for (int i = 0; i < numberEntries; i++) {
+        map.put(i, "old");
+    }
+
+    const auto snapshot = map.snapshot();
+
+    // modify the map after the snapshot has been taken
+    for (int i = 0; i < numberEntries; i += 2) {
+        map.put(i, "new");
+    }
+    map.remove(1);
+    map.put(numberEntries, "new");
+
+    EXPECT_EQ(numberEntries, snapshot.size());
+    string result;
+    for (int i = 0; i < numberEntries; i++) {
+        EXPECT_EQ(true, snapshot.get(i, result));
+        EXPECT_EQ("old", result);
+    }
+    EXPECT_EQ(false, snapshot.get(numberEntries, result));
+
+    // the map itself sees all modifications
+    EXPECT_EQ(true, map.get(0, result));
+    EXPECT_EQ("new", result);
+    EXPECT_EQ(false, map.get(1, result));
+    EXPECT_EQ(numberEntries, map.size());
+
+    int count = 0;
+    snapshot.for_each([&](const int &, const string &value) {
+        EXPECT_EQ("old", value);
+        count++;
+    });
+    EXPECT_EQ(numberEntries, count);
+}
+
+TEST(HashMapTest, SnapshotSurvivesResizeClearAndDestruction) {
+    auto map = new HashMap<int, string>();
+    const int numberEntries = 200;
+
+    for (int i = 0; i < numberEntries; i++) {
+        map->put(i, "first");
+    }
+    const auto first = map->snapshot();
+
+    map->put(0, "second");
+    const auto second = map->snapshot();
+
+    map->resize(17, 2);
+    map->clear();
+    map->put(0, "third");
+    const auto third = map->snapshot();
+    delete map;
+
+    string result;
+    EXPECT_EQ(true, first.get(0, result));
+    EXPECT_EQ("first", result);
+    EXPECT_EQ(true, second.get(0, result));
+    EXPECT_EQ("second", result);
+    EXPECT_EQ(true, second.get(numberEntries - 1, result));
+    EXPECT_EQ("first", result);
+    EXPECT_EQ(true, third.get(0, result));
+    EXPECT_EQ("third", result);
+    EXPECT_EQ(1, third.size());
+    EXPECT_EQ(false, third.get(1, result));
+}
+
+TEST(HashMapTest, SaveLoadFixedSize) {
+    const string path = testing::internal::TempDir() + "HashMapTest_SaveLoadFixedSize.bin";
+    HashMap<int, long> map;
+    const int numberEntries = 1000;
+
+    for (int i = 0; i < numberEntries; i++) {
+        map.put(i, i * 10L);
+    }
+    EXPECT_EQ(true, map.save(path));
+
+    HashMap<int, long> loaded;
+    loaded.put(-1, -1);
+    EXPECT_EQ(true, loaded.load(path, 3));
+    EXPECT_EQ(numberEntries, loaded.size());
+
+    long result;
+    EXPECT_EQ(false, loaded.get(-1, result));
+    for (int i = 0; i < numberEntries; i++) {
+        EXPECT_EQ(true, loaded.get(i, result));
+        EXPECT_EQ(i * 10L, result);
+    }
+
+    // the key and value types have to match the file
+    HashMap<long, long> mismatch;
+    EXPECT_EQ(false, mismatch.load(path));
+    remove(path.c_str());
+}
+
+TEST(HashMapTest, SaveLoadString) {
+    const string path = testing::internal::TempDir() + "HashMapTest_SaveLoadString.bin";
+    HashMap<string, string> map;
+    const int numberEntries = 100;
+
+    for (int i = 0; i < numberEntries; i++) {
+        map.put(to_string(i), string(i, 'x'));
+    }
+    EXPECT_EQ(true, map.save(path));
+
+    HashMap<string, string> loaded;
+    EXPECT_EQ(true, loaded.load(path));
+    EXPECT_EQ(numberEntries, loaded.size());
+
+    string result;
+    for (int i = 0; i < numberEntries; i++) {
+        EXPECT_EQ(true, loaded.get(to_string(i), result));
+        EXPECT_EQ(string(i, 'x'), result);
+    }
+
+    // a missing file leaves the map unchanged
+    EXPECT_EQ(false, loaded.load(path + ".missing"));
+    EXPECT_EQ(numberEntries, loaded.size());
+
+    // so does a header claiming more entries than the file can hold
+    const uint64_t entryCount = uint64_t(1) << 40;
+    FILE *file = fopen(path.c_str(), "r+b");
+    ASSERT_TRUE(file != NULL);
+    fseek(file, offsetof(SnapshotFileHeader, entryCount), SEEK_SET);
+    fwrite(&entryCount, sizeof(entryCount), 1, file);
+    fclose(file);
+    EXPECT_EQ(false, loaded.load(path));
+    EXPECT_EQ(numberEntries, loaded.size());
+    EXPECT_EQ(true, loaded.put("new", "entry"));
+    remove(path.c_str());
+}
+
+TEST(HashMapTest, CapacityEviction) {
+    HashMap<int, int> map;
+    const int capacity = 100;
+    const int hotKeys = 10;
+    map.setCapacity(capacity);
+
+    for (int i = 0; i < 1000; i++) {
+        // keep the first keys hot, the clock hand must not evict them
+        int result;
+        for (int key = 0; key < hotKeys && key < i; key++) {
+            EXPECT_EQ(true, map.get(key, result));
+        }
+        map.put(i, i);
+        EXPECT_LE(map.size(), capacity);
+    }
+
+    EXPECT_EQ(capacity, map.size());
+    for (int key = 0; key < hotKeys; key++) {
+        EXPECT_EQ(true, map.contains(key));
+    }
+    // the most recent key has just been inserted
+    EXPECT_EQ(true, map.contains(999));
+
+    // rows copied for a snapshot keep their reference bits, so the hot keys survive evictions while snapshots are
+    // taken, and the snapshots keep the evicted entries
+    for (int i = 1000; i < 2000; i++) {
+        int result;
+        for (int key = 0; key < hotKeys; key++) {
+            EXPECT_EQ(true, map.get(key, result));
+        }
+        const auto snapshot = map.snapshot();
+        map.put(i, i);
+        EXPECT_EQ(capacity, snapshot.size());
+    }
+    for (int key = 0; key < hotKeys; key++) {
+        EXPECT_EQ(true, map.contains(key));
+    }
+
+    // lowering the capacity evicts immediately
+    map.setCapacity(capacity / 2);
+    EXPECT_EQ(capacity / 2, map.size());
+
+    // a put on a full map keeps the size at the capacity
+    map.put(999, 0);
+    EXPECT_EQ(capacity / 2, map.size());
+}
+
+TEST(HashMapTest, AdmissionFilter) {
+    HashMap<int, int> map;
+    const int capacity = 100;
+    map.setCapacity(capacity, true);
+
+    int result;
+    for (int key = 0; key < capacity; key++) {
+        EXPECT_EQ(true, map.put(key, key));
+        for (int i = 0; i < 5; i++) {
+            EXPECT_EQ(true, map.get(key, result));
+        }
+    }
+
+    // a scan of keys used only once must not flush the frequently used ones. The sketch's estimates are approximate, so
+    // a few of them may be replaced by scan keys whose counters collide with frequently used keys
+    int rejected = 0;
+    for (int key = 1000; key < 2000; key++) {
+        rejected += map.put(key, key) ? 0 : 1;
+        EXPECT_LE(map.size(), capacity);
+    }
+    EXPECT_EQ(capacity, map.size());
+    EXPECT_GE(rejected, 900);
+    int retained = 0;
+    for (int key = 0; key < capacity; key++) {
+        retained += map.contains(key) ? 1 : 0;
+    }
+    EXPECT_GE(retained, capacity * 9 / 10);
+
+    // a key requested often enough is admitted, even though it has been missing so far. Reads reach the sketch in
+    // batches of a per-thread buffer, so the key is missed often enough to flush the buffer at least once
+    for (int i = 0; i < 32; i++) {
+        EXPECT_EQ(false, map.get(5000, result));
+    }
+    EXPECT_EQ(true, map.put(5000, 5000));
+    EXPECT_EQ(true, map.contains(5000));
+    EXPECT_EQ(capacity, map.size());
+
+    // updates of present keys are never rejected
+    EXPECT_EQ(true, map.put(0, 1));
+    EXPECT_EQ(true, map.get(0, result));
+    EXPECT_EQ(1, result);
+}
+
+TEST(HashMapTest, Expiry) {
+    const string path = testing::internal::TempDir() + "HashMapTest_Expiry.bin";
+    HashMap<int, int> map;
+    const int numberEntries = 100;
+
+    // even keys expire immediately, odd keys live for an hour
+    for (int i = 0; i < numberEntries; i++) {
+        map.put(i, i, chrono::milliseconds(i % 2 == 0 ? 0 : 3600 * 1000));
+    }
+    EXPECT_EQ(numberEntries, map.size());
+
+    int result;
+    for (int i = 0; i < numberEntries; i++) {
+        EXPECT_EQ(i % 2 != 0, map.contains(i));
+    }
+    int visited = 0;
+    map.for_each([&](const int &key, const int &) {
+        EXPECT_EQ(1, key % 2);
+        visited++;
+    });
+    EXPECT_EQ(numberEntries / 2, visited);
+
+    // saving skips the expired entries
+    EXPECT_EQ(true, map.save(path));
+    HashMap<int, int> loaded;
+    EXPECT_EQ(true, loaded.load(path));
+    EXPECT_EQ(numberEntries / 2, loaded.size());
+    remove(path.c_str());
+
+    // get() reclaims the entry it finds expired
+    EXPECT_EQ(false, map.get(0, result));
+    EXPECT_EQ(numberEntries - 1, map.size());
+
+    // expire() reclaims the remaining ones, a pass over all rows
+    EXPECT_EQ(numberEntries / 2 - 1, map.expire(constants::TABLE_SIZE));
+    EXPECT_EQ(numberEntries / 2, map.size());
+
+    // a put without ttl removes the expiry
+    map.put(1, 2, chrono::milliseconds(0));
+    map.put(1, 3);
+    EXPECT_EQ(true, map.get(1, result));
+    EXPECT_EQ(3, result);
+}
+
+TEST(HashMapTest, ExpirySweeper) {
+    HashMap<int, int> map;
+    const int numberEntries = 1000;
+    for (int i = 0; i < numberEntries; i++) {
+        map.put(i, i, chrono::milliseconds(1));
+    }
+
+    {
+        ExpirySweeper<HashMap<int, int> > sweeper(map, chrono::milliseconds(1), 10);
+        const auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+        while (map.size() > 0 && chrono::steady_clock::now() < deadline) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+    EXPECT_EQ(0, map.size());
+}
+
+TEST(HashMapTest, GetOrLoad) {
+    HashMap<int, string> map;
+    const int numberThreads = 8;
+    atomic<int> loadCount(0);
+
+    // slow fake backend, so all threads miss while the first load is in progress
+    auto loader = [&](const int &key, string &value) {
+        loadCount++;
+        this_thread::sleep_for(chrono::milliseconds(50));
+        if (key < 0) {
+            return false;
+        }
+        value = to_string(key);
+        return true;
+    };
+
+    vector<thread> threads;
+    vector<string> results(numberThreads);
+    for (int i = 0; i < numberThreads; i++) {
+        threads.push_back(thread([&, i]() {
+            EXPECT_EQ(true, map.get_or_load(42, results[i], loader));
+        }));
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(1, loadCount);
+    for (const auto &result : results) {
+        EXPECT_EQ("42", result);
+    }
+
+    // hits do not call the loader
+    string result;
+    EXPECT_EQ(true, map.get_or_load(42, result, loader));
+    EXPECT_EQ(1, loadCount);
+
+    // keys unknown to the loader are not inserted
+    EXPECT_EQ(false, map.get_or_load(-1, result, loader));
+    EXPECT_EQ(false, map.contains(-1));
+    EXPECT_EQ(1, map.size());
+}
+
+TEST(HashMapTest, GetOrLoadThrowingLoader) {
+    HashMap<int, string> map;
+    atomic<bool> loading(false);
+    atomic<bool> waiterStarted(false);
+    atomic<bool> waiterLoaded(false);
+
+    // the loader runs once the load has been registered, the waiter is only started then, so it finds the pending
+    // load and waits for it instead of loading itself
+    auto throwingLoader = [&](const int &, string &) -> bool {
+        loading = true;
+        while (!waiterStarted) {
+            this_thread::yield();
+        }
+        this_thread::sleep_for(chrono::milliseconds(50));
+        throw runtime_error("backend unavailable");
+    };
+    auto missingLoader = [&](const int &, string &) {
+        waiterLoaded = true;
+        return false;
+    };
+
+    thread leader([&]() {
+        string value;
+        EXPECT_THROW(map.get_or_load(1, value, throwingLoader), runtime_error);
+    });
+    while (!loading) {
+        this_thread::yield();
+    }
+    thread waiter([&]() {
+        string value;
+        waiterStarted = true;
+        EXPECT_EQ(false, map.get_or_load(1, value, missingLoader));
+    });
+    leader.join();
+    waiter.join();
+    EXPECT_EQ(false, waiterLoaded.load());
+
+    // the failed load has been unregistered, the next miss loads again
+    string result;
+    EXPECT_EQ(true, map.get_or_load(1, result, [](const int &, string &value) {
+        value = "one";
+        return true;
+    }));
+    EXPECT_EQ("one", result);
+}
+
+TEST(HashMapTest, MemoryUsage) {
+    HashMap<int, string> map;
+    const int numberEntries = 100;
+    const auto empty = map.memory_usage();
+    EXPECT_EQ(0u, empty.payload);
+
+    for (int i = 0; i < numberEntries; i++) {
+        map.put(i, string(100, 'x'));
+    }
+    map.setPayloadSizer([](const int &, const string &value) {
+        return value.size();
+    });
+
+    auto usage = map.memory_usage();
+    EXPECT_EQ(numberEntries * 100u, usage.payload);
+    EXPECT_GT(usage.structure, empty.structure);
+    EXPECT_EQ(usage.structure + usage.payload, usage.total());
+
+    // updates and removals are accounted for
+    map.put(0, string(50, 'x'));
+    map.remove(1);
+    EXPECT_EQ((numberEntries - 2) * 100u + 50u, map.memory_usage().payload);
+    map.clear();
+    EXPECT_EQ(0u, map.memory_usage().payload);
+}
+
+TEST(HashMapTest, MemoryBudget) {
+    HashMap<int, string> map;
+    map.setPayloadSizer([](const int &, const string &value) {
+        return value.size();
+    });
+    const size_t budget = map.memory_usage().total() + 10000;
+
+    // rejecting budget, the entries of 1000 bytes stop fitting after less than ten entries
+    map.setMemoryBudget(budget);
+    int accepted = 0;
+    for (int i = 0; i < 20; i++) {
+        accepted += map.put(i, string(1000, 'x')) ? 1 : 0;
+        EXPECT_LE(map.memory_usage().total(), budget);
+    }
+    EXPECT_GT(accepted, 0);
+    EXPECT_LT(accepted, 10);
+    EXPECT_EQ(accepted, map.size());
+
+    // shrinking the value of a present key always fits
+    EXPECT_EQ(true, map.put(0, string(10, 'x')));
+
+    // evicting budget, every put succeeds and old entries make room
+    map.setMemoryBudget(budget, true);
+    for (int i = 100; i < 200; i++) {
+        EXPECT_EQ(true, map.put(i, string(1000, 'x')));
+        EXPECT_LE(map.memory_usage().total(), budget);
+    }
+    EXPECT_EQ(true, map.contains(199));
+
+    // lowering an evicting budget evicts immediately
+    map.setMemoryBudget(budget - 5000, true);
+    EXPECT_LE(map.memory_usage().total(), budget - 5000);
+}
+
+TEST(HashMapTest, StatsDisabled) {
+    HashMap<int, int> map(10);
+    for (int i = 0; i < 15; i++) {
+        map.put(i, i);
+    }
+
+    // without HASHMAP_STATS only the chain lengths are reported
+    const auto stats = map.stats();
+    EXPECT_EQ(false, stats.enabled);
+    EXPECT_EQ(0u, stats.getHits);
+    EXPECT_TRUE(stats.rowLockAcquisitions.empty());
+
+    uint64_t rows = 0;
+    uint64_t entries = 0;
+    for (size_t length = 0; length < stats.chainLengths.size(); length++) {
+        rows += stats.chainLengths[length];
+        entries += length * stats.chainLengths[length];
+    }
+    EXPECT_EQ(10u, rows);
+    EXPECT_EQ(15u, entries);
+}
+
+TEST(HashMapTest, TransparentLookup) {
+    HashMap<string, int, StringHash, equal_to<> > map;
+    map.put("alpha", 1);
+    map.put("beta", 2);
+
+    int value;
+    const char *alpha = "alpha";
+    EXPECT_TRUE(map.get(alpha, value));
+    EXPECT_EQ(1, value);
+    EXPECT_TRUE(map.get("beta", value));
+    EXPECT_EQ(2, value);
+    EXPECT_FALSE(map.get("gamma", value));
+    EXPECT_TRUE(map.get(string("alpha"), value));
+
+    EXPECT_TRUE(map.contains("beta"));
+    EXPECT_FALSE(map.contains("gamma"));
+
+    map.remove("alpha");
+    EXPECT_FALSE(map.contains(alpha));
+    EXPECT_FALSE(map.contains(string("alpha")));
+    EXPECT_EQ(1, map.size());
+
+    // keys hash equally regardless of their type
+    EXPECT_EQ(StringHash()(string("beta")), StringHash()("beta"));
+}
+
+// counts the nodes allocated through it, copies share the counter
+template<typename T>
+struct CountingAllocator {
+    typedef T value_type;
+
+    explicit CountingAllocator(const shared_ptr<int> &live) :
+            live(live) {
+    }
+
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U> &other) :
+            live(other.live) {
+    }
+
+    T *allocate(const size_t n) {
+        *live += n;
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, const size_t n) {
+        *live -= n;
+        ::operator delete(p);
+    }
+
+    template<typename U>
+    bool operator==(const CountingAllocator<U> &other) const {
+        return live == other.live;
+    }
+
+    template<typename U>
+    bool operator!=(const CountingAllocator<U> &other) const {
+        return live != other.live;
+    }
+
+    shared_ptr<int> live;
+};
+
+// compares and hashes only the first character
+struct FirstCharHash {
+    size_t operator()(const string &key) const {
+        return key.empty() ? 0 : key[0];
+    }
+};
+
+struct FirstCharEqual {
+    bool operator()(const string &a, const string &b) const {
+        return a.substr(0, 1) == b.substr(0, 1);
+    }
+};
+
+TEST(HashMapTest, KeyEqualAndAllocator) {
+    const auto live = make_shared<int>(0);
+    {
+        typedef CountingAllocator<pair<const string, int> > Allocator;
+        HashMap<string, int, FirstCharHash, FirstCharEqual, Allocator> map(16, FirstCharHash(), FirstCharEqual(),
+                Allocator(live));
+        map.put("apple", 1);
+        map.put("avocado", 2);
+        map.put("banana", 3);
+        EXPECT_EQ(2, map.size());
+        EXPECT_EQ(2, *live);
+
+        int value;
+        EXPECT_TRUE(map.get("almond", value));
+        EXPECT_EQ(2, value);
+
+        // the copy-on-write of a row after a snapshot allocates through the same allocator
+        const auto snapshot = map.snapshot();
+        map.put("cherry", 4);
+        EXPECT_TRUE(snapshot.get("apricot", value));
+        EXPECT_FALSE(snapshot.get("cranberry", value));
+
+        map.resize(64);
+        map.remove("blueberry");
+        EXPECT_FALSE(map.contains("banana"));
+        EXPECT_EQ(2, map.size());
+    }
+    EXPECT_EQ(0, *live);
+}
+
+TEST(HashMapTest, HashFunctions) {
+    // multiples of the row count all fall into row 0 with the identity hash
+    const int rowCount = 100;
+    vector<int> rows(rowCount);
+    for (int i = 0; i < 1000; i++) {
+        rows[IntegerHash()(i * rowCount) % rowCount]++;
+    }
+    EXPECT_LT(*max_element(rows.begin(), rows.end()), 40);
+
+    // all lengths take a different code path up to 48 bytes
+    const FastStringHash hash;
+    string key;
+    for (int length = 0; length < 100; length++) {
+        EXPECT_EQ(hash(key), hash(key.c_str()));
+        EXPECT_NE(hash(key), hash(key + "x"));
+        EXPECT_NE(hash(key), FastStringHash(1)(key));
+        key += static_cast<char>('a' + length % 26);
+    }
+
+    // seeds differ between instances, a map works with its own
+    EXPECT_NE(RandomSeeded<IntegerHash>().seed(), RandomSeeded<IntegerHash>().seed());
+    HashMap<string, int, RandomSeeded<FastStringHash>, equal_to<> > map;
+    for (int i = 0; i < 100; i++) {
+        map.put(to_string(i), i);
+    }
+    int value;
+    EXPECT_TRUE(map.get("42", value));
+    EXPECT_EQ(42, value);
+    EXPECT_EQ(100, map.size());
+}
+
+TEST(HashMapTest, HashFunctionSeeds) {
+    // keys whose words cancel the constants mixed into the multiplications, once for the last 16 bytes of a 16 byte
+    // key and once for the first 16 bytes of a 48 byte key as well
+    for (const size_t length : { size_t(16), size_t(48) }) {
+        vector<string> keys;
+        for (uint64_t i = 0; i < 1000; i++) {
+            string key(length, '\0');
+            const uint64_t high = hashing::SECRET[1] >> 32, low = hashing::SECRET[1] & 0xffffffff;
+            const size_t last = length - 16;
+            memcpy(&key[last], &high, 4);
+            memcpy(&key[last + 4], &i, 4);
+            memcpy(&key[last + 8], &low, 4);
+            memcpy(&key[last + 12], &i, 4);
+            if (length > 16) {
+                memcpy(&key[0], &hashing::SECRET[1], 8);
+                memcpy(&key[8], &i, 8);
+            }
+            keys.push_back(key);
+        }
+
+        // the keys spread under every seed, and differently under different seeds
+        const FastStringHash hashes[] = { FastStringHash(0), FastStringHash(12345), RandomSeeded<FastStringHash>() };
+        for (const auto &hash : hashes) {
+            set<size_t> distinct;
+            for (const auto &key : keys) {
+                distinct.insert(hash(key));
+            }
+            EXPECT_EQ(keys.size(), distinct.size());
+        }
+        int sameHash = 0;
+        for (const auto &key : keys) {
+            sameHash += hashes[0](key) == hashes[1](key);
+        }
+        EXPECT_EQ(0, sameHash);
+    }
+}
+
+TEST(HashMapTest, PutIfAbsent) {
+    HashMap<int, string> map;
+    EXPECT_EQ(true, map.put_if_absent(1, "first"));
+    EXPECT_EQ(false, map.put_if_absent(1, "second"));
+
+    string result;
+    EXPECT_EQ(true, map.get(1, result));
+    EXPECT_EQ("first", result);
+    EXPECT_EQ(1, map.size());
+
+    // an expired entry counts as absent
+    map.put(2, "expiring", chrono::milliseconds(1));
+    this_thread::sleep_for(chrono::milliseconds(5));
+    EXPECT_EQ(true, map.put_if_absent(2, "replaced"));
+    EXPECT_EQ(true, map.get(2, result));
+    EXPECT_EQ("replaced", result);
+    EXPECT_EQ(2, map.size());
+}
+
+TEST(HashMapTest, ValuesWithoutSerializer) {
+    // only save(), load() and the write-ahead log need a Serializer for key and value
+    HashMap<string, vector<int> > map;
+    map.put("a", vector<int>(3, 1));
+
+    vector<int> result;
+    EXPECT_EQ(true, map.get("a", result));
+    EXPECT_EQ(3u, result.size());
+    map.remove("a");
+    EXPECT_EQ(false, map.contains("a"));
+    map.clear();
+}
+
 struct add_entries_struct {
     HashMap<int, string> * mMap;
 
@@ -0,0 +1,132 @@
+/*
+ * PersistentHashMapTest.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: Patrick Gunia
+ */
+
+#include <gtest/gtest.h>
+#include <PersistentHashMap.hpp>
+#include <cstddef>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+TEST(PersistentHashMapTest, PutGetRemove) {
+    const string path = testing::internal::TempDir() + "PersistentHashMapTest_PutGetRemove.bin";
+    remove(path.c_str());
+
+    PersistentHashMap<int, long> map(path);
+    ASSERT_EQ(true, map.isOpen());
+
+    map.put(1, 10);
+    map.put(1, 11);
+    map.put(2, 20);
+    map.remove(2);
+
+    long result;
+    EXPECT_EQ(true, map.get(1, result));
+    EXPECT_EQ(11, result);
+    EXPECT_EQ(false, map.get(2, result));
+    EXPECT_EQ(1, map.size());
+    remove(path.c_str());
+}
+
+TEST(PersistentHashMapTest, SurvivesReopenAndGrowth) {
+    const string path = testing::internal::TempDir() + "PersistentHashMapTest_SurvivesReopen.bin";
+    remove(path.c_str());
+    const int numberEntries = 1000;
+
+    {
+        // start with a tiny node area, so the file has to grow several times
+        PersistentHashMap<int, long> map(path, 17, 4);
+        ASSERT_EQ(true, map.isOpen());
+        for (int i = 0; i < numberEntries; i++) {
+            EXPECT_EQ(true, map.put(i, i * 2L));
+        }
+    }
+
+    {
+        PersistentHashMap<int, long> reopened(path);
+        ASSERT_EQ(true, reopened.isOpen());
+        EXPECT_EQ(numberEntries, reopened.size());
+
+        long result;
+        for (int i = 0; i < numberEntries; i++) {
+            EXPECT_EQ(true, reopened.get(i, result));
+            EXPECT_EQ(i * 2L, result);
+        }
+    }
+
+    // a file created for other types is refused and left untouched
+    {
+        PersistentHashMap<long, long> mismatch(path);
+        EXPECT_EQ(false, mismatch.isOpen());
+    }
+    PersistentHashMap<int, long> reopened(path);
+    ASSERT_EQ(true, reopened.isOpen());
+    EXPECT_EQ(numberEntries, reopened.size());
+
+    // the file is locked while it is open, a second map is refused and does not touch it
+    {
+        PersistentHashMap<int, long> second(path);
+        EXPECT_EQ(false, second.isOpen());
+    }
+    EXPECT_EQ(true, reopened.put(numberEntries, 0));
+    EXPECT_EQ(numberEntries + 1, reopened.size());
+    remove(path.c_str());
+}
+
+TEST(PersistentHashMapTest, RecoversAfterUncleanShutdown) {
+    const string path = testing::internal::TempDir() + "PersistentHashMapTest_Recovers.bin";
+    remove(path.c_str());
+    const int rowCount = 17;
+    const int numberEntries = 100;
+
+    {
+        PersistentHashMap<int, long> map(path, rowCount, numberEntries);
+        ASSERT_EQ(true, map.isOpen());
+        for (int i = 0; i < numberEntries; i++) {
+            map.put(i, i);
+        }
+    }
+
+    // simulate a process that died while unlinking from row 0: the file is not marked clean and the first link of the
+    // row points into the header
+    const int fd = open(path.c_str(), O_RDWR);
+    ASSERT_LE(0, fd);
+    const uint32_t clean = 0;
+    const uint64_t brokenLink = 8;
+    EXPECT_EQ(ssize_t(sizeof(clean)),
+            pwrite(fd, &clean, sizeof(clean), offsetof(OffsetHashTableHeader, clean)));
+    EXPECT_EQ(ssize_t(sizeof(brokenLink)),
+            pwrite(fd, &brokenLink, sizeof(brokenLink), sizeof(OffsetHashTableHeader)));
+    close(fd);
+
+    PersistentHashMap<int, long> map(path);
+    ASSERT_EQ(true, map.isOpen());
+
+    // std::hash is the identity, thus the keys of row 0 are the multiples of the row count
+    const int lostEntries = (numberEntries - 1) / rowCount + 1;
+    EXPECT_EQ(numberEntries - lostEntries, map.size());
+    long result;
+    EXPECT_EQ(false, map.get(0, result));
+    EXPECT_EQ(true, map.get(1, result));
+    EXPECT_EQ(1, result);
+
+    // all nodes had been used, the nodes of the lost entries are reused instead of growing the file
+    struct stat before;
+    ASSERT_EQ(0, stat(path.c_str(), &before));
+    for (int i = 0; i < numberEntries; i += rowCount) {
+        EXPECT_EQ(true, map.put(i, i));
+    }
+    struct stat after;
+    ASSERT_EQ(0, stat(path.c_str(), &after));
+    EXPECT_EQ(before.st_size, after.st_size);
+    EXPECT_EQ(numberEntries, map.size());
+    EXPECT_EQ(true, map.get(0, result));
+    remove(path.c_str());
+}
@@ -0,0 +1,80 @@
+/*
+ * SharedMemoryHashMapTest.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: Patrick Gunia
+ */
+
+#include <gtest/gtest.h>
+#include <SharedMemoryHashMap.hpp>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+TEST(SharedMemoryHashMapTest, SharedBetweenInstances) {
+    const string name = "/SharedMemoryHashMapTest_Instances";
+    SharedMemoryHashMap<int, long>::unlink(name);
+
+    SharedMemoryHashMap<int, long> creator(name, 17, 100);
+    SharedMemoryHashMap<int, long> attached(name);
+    ASSERT_EQ(true, creator.isOpen());
+    ASSERT_EQ(true, attached.isOpen());
+
+    creator.put(1, 10);
+    attached.put(2, 20);
+    attached.remove(1);
+
+    long result;
+    EXPECT_EQ(false, creator.get(1, result));
+    EXPECT_EQ(true, creator.get(2, result));
+    EXPECT_EQ(20, result);
+    EXPECT_EQ(1, creator.size());
+
+    // the node capacity is fixed, released nodes are reused
+    for (int i = 0; i < 99; i++) {
+        EXPECT_EQ(true, creator.put(100 + i, i));
+    }
+    EXPECT_EQ(false, creator.put(1000, 0));
+    creator.remove(100);
+    EXPECT_EQ(true, attached.put(1000, 0));
+
+    attached.clear();
+    EXPECT_EQ(0, creator.size());
+    SharedMemoryHashMap<int, long>::unlink(name);
+}
+
+TEST(SharedMemoryHashMapTest, SharedBetweenProcesses) {
+    const string name = "/SharedMemoryHashMapTest_Processes";
+    SharedMemoryHashMap<int, long>::unlink(name);
+    const int numberEntries = 1000;
+
+    SharedMemoryHashMap<int, long> map(name, 101, numberEntries);
+    ASSERT_EQ(true, map.isOpen());
+
+    const pid_t child = fork();
+    ASSERT_NE(-1, child);
+    if (child == 0) {
+        // the child attaches on its own and fills the map
+        SharedMemoryHashMap<int, long> childMap(name);
+        if (!childMap.isOpen()) {
+            _exit(1);
+        }
+        for (int i = 0; i < numberEntries; i++) {
+            childMap.put(i, i * 3L);
+        }
+        _exit(0);
+    }
+
+    int status;
+    waitpid(child, &status, 0);
+    EXPECT_EQ(0, WEXITSTATUS(status));
+
+    EXPECT_EQ(numberEntries, map.size());
+    long result;
+    for (int i = 0; i < numberEntries; i++) {
+        EXPECT_EQ(true, map.get(i, result));
+        EXPECT_EQ(i * 3L, result);
+    }
+    SharedMemoryHashMap<int, long>::unlink(name);
+}
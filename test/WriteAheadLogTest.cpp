@@ -0,0 +1,217 @@
+/*
+ * WriteAheadLogTest.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: Patrick Gunia
+ */
+
+#include <gtest/gtest.h>
+#include <HashMap.hpp>
+#include <PeriodicCheckpointer.hpp>
+#include <WriteAheadLog.hpp>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    // removes the checkpoint and all log segments of a test
+    void removeFiles(const string &checkpointPath, const string &logPath) {
+        remove(checkpointPath.c_str());
+        const string directory = testing::internal::TempDir();
+        const string prefix = logPath.substr(directory.size()) + ".";
+        DIR *dir = opendir(directory.c_str());
+        while (const dirent *entry = readdir(dir)) {
+            if (string(entry->d_name).compare(0, prefix.size(), prefix) == 0) {
+                remove((directory + entry->d_name).c_str());
+            }
+        }
+        closedir(dir);
+    }
+}
+
+TEST(WriteAheadLogTest, ReplayAfterRestart) {
+    const string checkpointPath = testing::internal::TempDir() + "WriteAheadLogTest_Replay.checkpoint";
+    const string logPath = testing::internal::TempDir() + "WriteAheadLogTest_Replay.log";
+    removeFiles(checkpointPath, logPath);
+
+    {
+        WriteAheadLog<int, string> log(logPath);
+        ASSERT_EQ(true, log.isOpen());
+        HashMap<int, string> map;
+        EXPECT_EQ(true, map.recover(checkpointPath, log));
+
+        map.put(1, "one");
+        map.put(2, "two");
+        map.clear();
+        map.put(3, "three");
+        map.put(4, "four");
+        map.put(3, "drei");
+        map.remove(4);
+    }
+
+    WriteAheadLog<int, string> log(logPath);
+    HashMap<int, string> map;
+    EXPECT_EQ(true, map.recover(checkpointPath, log));
+
+    EXPECT_EQ(1, map.size());
+    string result;
+    EXPECT_EQ(true, map.get(3, result));
+    EXPECT_EQ("drei", result);
+    removeFiles(checkpointPath, logPath);
+}
+
+TEST(WriteAheadLogTest, CheckpointTruncatesLog) {
+    const string checkpointPath = testing::internal::TempDir() + "WriteAheadLogTest_Checkpoint.checkpoint";
+    const string logPath = testing::internal::TempDir() + "WriteAheadLogTest_Checkpoint.log";
+    removeFiles(checkpointPath, logPath);
+    const int numberEntries = 100;
+
+    {
+        WriteAheadLog<int, long> log(logPath);
+        HashMap<int, long> map;
+        EXPECT_EQ(true, map.recover(checkpointPath, log));
+
+        for (int i = 0; i < numberEntries; i++) {
+            map.put(i, i);
+        }
+        EXPECT_EQ(true, map.checkpoint(checkpointPath));
+        map.put(numberEntries, numberEntries);
+    }
+
+    // only the segment written after the checkpoint and the empty segment of the second run remain
+    FILE *truncated = fopen((logPath + ".0000000001").c_str(), "r");
+    EXPECT_TRUE(truncated == NULL);
+
+    WriteAheadLog<int, long> log(logPath);
+    HashMap<int, long> map;
+    EXPECT_EQ(true, map.recover(checkpointPath, log));
+    EXPECT_EQ(numberEntries + 1, map.size());
+
+    long result;
+    for (int i = 0; i <= numberEntries; i++) {
+        EXPECT_EQ(true, map.get(i, result));
+        EXPECT_EQ(i, result);
+    }
+    removeFiles(checkpointPath, logPath);
+}
+
+TEST(WriteAheadLogTest, FailedWriteIsReported) {
+    const string checkpointPath = testing::internal::TempDir() + "WriteAheadLogTest_Failed.checkpoint";
+    const string logPath = testing::internal::TempDir() + "WriteAheadLogTest_Failed.log";
+    removeFiles(checkpointPath, logPath);
+
+    WriteAheadLog<int, string> log(logPath);
+    ASSERT_EQ(true, log.isOpen());
+    HashMap<int, string> map;
+    EXPECT_EQ(true, map.recover(checkpointPath, log));
+    EXPECT_EQ(true, map.put(1, "one"));
+
+    // files may not grow any further, thus writing the next record fails with EFBIG instead of raising SIGXFSZ
+    rlimit limit;
+    ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &limit));
+    const rlimit previousLimit = limit;
+    const auto previousHandler = signal(SIGXFSZ, SIG_IGN);
+    limit.rlim_cur = 1;
+    ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+    const bool putResult = map.put(2, "two");
+    setrlimit(RLIMIT_FSIZE, &previousLimit);
+    signal(SIGXFSZ, previousHandler);
+
+    // the change is applied, but not durable, and the log refuses all later records
+    EXPECT_EQ(false, putResult);
+    EXPECT_EQ(true, log.failed());
+    EXPECT_EQ(true, map.contains(2));
+    EXPECT_EQ(false, map.put(3, "three"));
+    EXPECT_EQ(false, map.remove(1));
+    EXPECT_EQ(false, map.checkpoint(checkpointPath));
+
+    map.setWriteAheadLog(NULL);
+    removeFiles(checkpointPath, logPath);
+}
+
+TEST(WriteAheadLogTest, GroupCommit) {
+    const string checkpointPath = testing::internal::TempDir() + "WriteAheadLogTest_GroupCommit.checkpoint";
+    const string logPath = testing::internal::TempDir() + "WriteAheadLogTest_GroupCommit.log";
+    removeFiles(checkpointPath, logPath);
+    const int numberOfThreads = 8;
+    const int iterations = 10;
+
+    {
+        WriteAheadLog<int, int> log(logPath);
+        ASSERT_EQ(true, log.isOpen());
+        const uint64_t flushesBefore = log.flushCount();
+
+        // every writer appends its records before any of them syncs, so all writers wait for records of the same batch
+        atomic<int> appended(0);
+        atomic<int> failedSyncs(0);
+        vector<thread> writers;
+        for (int t = 0; t < numberOfThreads; t++) {
+            writers.emplace_back([&log, &appended, &failedSyncs, t, iterations, numberOfThreads]() {
+                uint64_t lsn = 0;
+                for (int i = 0; i < iterations; i++) {
+                    lsn = log.appendPut(t * iterations + i, t);
+                }
+                appended++;
+                while (appended.load() < numberOfThreads) {
+                    this_thread::yield();
+                }
+                if (!log.sync(lsn)) {
+                    failedSyncs++;
+                }
+            });
+        }
+        for (auto &writer : writers) {
+            writer.join();
+        }
+
+        // the first leader writes the records of all writers, the others find theirs durable
+        EXPECT_EQ(0, failedSyncs.load());
+        EXPECT_EQ(1u, log.flushCount() - flushesBefore);
+    }
+
+    WriteAheadLog<int, int> log(logPath);
+    HashMap<int, int> map;
+    EXPECT_EQ(true, map.recover(checkpointPath, log));
+    EXPECT_EQ(numberOfThreads * iterations, map.size());
+    removeFiles(checkpointPath, logPath);
+}
+
+TEST(WriteAheadLogTest, PeriodicCheckpointWithConcurrentWriters) {
+    const string checkpointPath = testing::internal::TempDir() + "WriteAheadLogTest_Periodic.checkpoint";
+    const string logPath = testing::internal::TempDir() + "WriteAheadLogTest_Periodic.log";
+    removeFiles(checkpointPath, logPath);
+    const int numberOfThreads = 8;
+    const int iterations = 200;
+
+    {
+        WriteAheadLog<int, int> log(logPath);
+        HashMap<int, int> map;
+        EXPECT_EQ(true, map.recover(checkpointPath, log));
+        PeriodicCheckpointer<HashMap<int, int> > checkpointer(map, checkpointPath, chrono::milliseconds(5));
+
+        vector<thread> writers;
+        for (int t = 0; t < numberOfThreads; t++) {
+            writers.emplace_back([&map, t, iterations]() {
+                for (int i = 0; i < iterations; i++) {
+                    map.put(t * iterations + i, t);
+                }
+            });
+        }
+        for (auto &writer : writers) {
+            writer.join();
+        }
+    }
+
+    WriteAheadLog<int, int> log(logPath);
+    HashMap<int, int> map;
+    EXPECT_EQ(true, map.recover(checkpointPath, log));
+    EXPECT_EQ(numberOfThreads * iterations, map.size());
+    removeFiles(checkpointPath, logPath);
+}